@@ -0,0 +1,31 @@
+#include <string.h>
+#include <strings.h>
+
+#include "app_order.h"
+
+int app_order_cmp(const app_order_key_t *a, const app_order_key_t *b) {
+    if (a->starred != b->starred)
+        return a->starred ? -1 : 1;
+
+    int res = strcasecmp(a->name, b->name);
+    if (res != 0)
+        return res;
+
+    return strcmp(a->path, b->path);
+}
+
+size_t app_order_upper_bound(const void *keys, size_t len, size_t key_size, const void *key, int (*cmp)(const void *, const void *)) {
+    size_t lo = 0;
+    size_t hi = len;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+
+        if (cmp(key, (const char *) keys + mid * key_size) < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return lo;
+}
\ No newline at end of file
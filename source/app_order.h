@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * The order apps are listed in. This doesn't depend on libnx or LVGL,
+ * so it can be tested on the host.
+ */
+
+typedef struct {
+    const char *name;
+    const char *path;
+    bool starred;
+} app_order_key_t;
+
+// Starred apps first, then by name. The path breaks ties, so the order doesn't depend on the order apps are found in
+int app_order_cmp(const app_order_key_t *a, const app_order_key_t *b);
+
+// Where a key goes in a sorted array, after the keys that compare equal to it
+size_t app_order_upper_bound(const void *keys, size_t len, size_t key_size, const void *key, int (*cmp)(const void *, const void *));
\ No newline at end of file
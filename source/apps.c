@@ -1,18 +1,30 @@
 #include <stdio.h>
-#include <dirent.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <threads.h>
 #include <limits.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <minizip/unzip.h>
+#include <zlib.h>
 #include <libconfig.h>
 #include <lvgl/lvgl.h>
 #include <switch.h>
 
 #include "apps.h"
+#include "app_order.h"
+#include "apps_index.h"
+#include "favorites.h"
+#include "icon_pool.h"
+#include "thumbs.h"
 #include "log.h"
 #include "util.h"
 #include "main.h"
 #include "theme.h"
+#include "settings.h"
+#include "decoder.h"
 
 static AppEntryType get_app_type(char *path) {
     char *ext = get_ext(path);
@@ -26,256 +38,573 @@ static AppEntryType get_app_type(char *path) {
     return AppEntryType_none;
 }
 
-void app_entry_init_base(app_entry_t *entry, char *path) {
-    strncpy(entry->path, path, PATH_MAX);
-    entry->path[PATH_MAX] = '\0';
+static char g_empty_str[] = "";
 
-    entry->args[0] = '\0';
-    app_entry_add_arg(entry, path);
+// Shown until the icon is loaded, it's fully transparent
+static lv_color_t g_icon_placeholder_data[APP_ICON_SMALL_W * APP_ICON_SMALL_H];
+static const lv_img_dsc_t g_icon_placeholder = {
+    .header.always_zero = 0,
+    .header.w = APP_ICON_SMALL_W,
+    .header.h = APP_ICON_SMALL_H,
+    .data_size = sizeof(g_icon_placeholder_data),
+    .header.cf = LV_IMG_CF_TRUE_COLOR_ALPHA,
+    .data = (const u8 *) g_icon_placeholder_data,
+};
 
-    char star_path[PATH_MAX + 1];
-    app_entry_get_star_path(entry, star_path);
-    entry->starred = is_file(star_path);
+static void app_entry_init_path(app_entry_t *entry, char *path) {
+    entry->path = path;
+
+    entry->name = g_empty_str;
+    entry->author = g_empty_str;
+    entry->version = g_empty_str;
 
     entry->type = get_app_type(path);
+
+    entry->icon_loc = (app_icon_loc_t) {
+        .thumb_slot = -1,
+    };
+    entry->thumb_key = 0;
+
+    memset(&entry->icon, 0, sizeof(lv_img_dsc_t));
+    entry->icon_small = g_icon_placeholder;
+    entry->icon_pending = false;
 }
 
-lv_res_t app_entry_init_icon(app_entry_t *entry) {
-    void *data = NULL;
-    u32 size = 0;
+static void app_entry_init_star(app_entry_t *entry) {
+    // Until the favorites file has been written, stars are imported from the .star files
+    if (favorites_importing()) {
+        char star_path[PATH_MAX + 1];
+        app_entry_get_star_path(entry, star_path);
+        entry->starred = is_file(star_path);
+    } else {
+        entry->starred = favorites_contains(entry->path);
+    }
+}
 
-    switch (entry->type) {
-        case AppEntryType_homebrew: {
-            FILE *fp = fopen(entry->path, "rb");
-            if (fp == NULL) {
-                LV_LOG_WARN("Bad file");
-                return LV_RES_INV;
-            }
+void app_entry_init_base(app_entry_t *entry, char *path) {
+    app_entry_init_path(entry, path);
+    app_entry_init_star(entry);
+}
 
-            NroHeader header;
-            NroAssetHeader asset_header;
+/*
+ * Reads the info or the icon of an NRO with a single open. Of the NACP only
+ * the first language entry and the display version are read, as two small
+ * reads instead of the whole 0x4000 bytes.
+ */
+static lv_res_t nro_read(app_entry_t *entry, app_icon_loc_t *loc, app_info_t *info, void **icon_data) {
+    FILE *fp = fopen(entry->path, "rb");
+    if (fp == NULL) {
+        LV_LOG_WARN("Bad file");
+        return LV_RES_INV;
+    }
 
-            fseek(fp, sizeof(NroStart), SEEK_SET);
-            if (fread(&header, sizeof(header), 1, fp) != 1) {
-                LV_LOG_WARN("Bad header read");
-                fclose(fp);
-                return LV_RES_INV;
-            }
+    // All reads are done in as few calls as possible, so buffering would only add copies
+    setvbuf(fp, NULL, _IONBF, 0);
 
-            fseek(fp, header.size, SEEK_SET);
-            if (fread(&asset_header, sizeof(asset_header), 1, fp) != 1) {
-                LV_LOG_WARN("Bad asset header read");
-                fclose(fp);
-                return LV_RES_INV;
-            }
+    struct {
+        NroStart start;
+        NroHeader header;
+    } nro;
 
-            size = asset_header.icon.size;
-            data = lv_mem_alloc(size);
-            if (data == NULL) {
-                LV_LOG_WARN("Bad icon alloc");
-                fclose(fp);
-                return LV_RES_INV;
-            }
+    if (fread(&nro, sizeof(nro), 1, fp) != 1) {
+        LV_LOG_WARN("Bad header read");
+        fclose(fp);
+        return LV_RES_INV;
+    }
 
-            fseek(fp, header.size + asset_header.icon.offset, SEEK_SET);
-            if (fread((u8 *) data, size, 1, fp) != 1) {
-                LV_LOG_WARN("Bad icon read");
-                lv_mem_free(data);
-                fclose(fp);
-                return LV_RES_INV;
-            }
+    NroAssetHeader asset_header;
+
+    fseek(fp, nro.header.size, SEEK_SET);
+    if (fread(&asset_header, sizeof(asset_header), 1, fp) != 1 || asset_header.magic != NROASSETHEADER_MAGIC) {
+        LV_LOG_WARN("Bad asset header read");
+        fclose(fp);
+        return LV_RES_INV;
+    }
+
+    loc->offset = nro.header.size + asset_header.icon.offset;
+    loc->size = asset_header.icon.size;
 
+    if (icon_data != NULL) {
+        u8 *data = malloc(loc->size);
+        if (data == NULL) {
+            LV_LOG_WARN("Bad icon alloc");
             fclose(fp);
-        } break;
+            return LV_RES_INV;
+        }
 
-        case AppEntryType_theme: {
-            unzFile zf = unzOpen(entry->path);
-            if (zf == NULL)
-                return LV_RES_INV;
+        fseek(fp, loc->offset, SEEK_SET);
+        if (fread(data, loc->size, 1, fp) != 1) {
+            LV_LOG_WARN("Bad icon read");
+            free(data);
+            fclose(fp);
+            return LV_RES_INV;
+        }
 
-            if (unzLocateFile(zf, "icon.jpg", 0) != UNZ_OK) {
-                unzClose(zf);
-                return LV_RES_INV;
-            }
+        *icon_data = data;
+    }
 
-            if (unzOpenCurrentFile(zf) != UNZ_OK) {
-                unzClose(zf);
-                return LV_RES_INV;
-            }
+    if (info != NULL) {
+        u64 nacp_offset = nro.header.size + asset_header.nacp.offset;
 
-            unz_file_info file_info;
-            if (unzGetCurrentFileInfo(zf, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK) {
-                unzCloseCurrentFile(zf);
-                unzClose(zf);
-                return LV_RES_INV;
-            }
+        NacpLanguageEntry lang;
+        fseek(fp, nacp_offset + offsetof(NacpStruct, lang), SEEK_SET);
+        if (fread(&lang, sizeof(lang), 1, fp) != 1) {
+            LV_LOG_WARN("Bad nacp read");
+            goto fail_info;
+        }
 
-            size = file_info.uncompressed_size;
-            data = lv_mem_alloc(size);
-            if (data == NULL) {
-                unzCloseCurrentFile(zf);
-                unzClose(zf);
-                return LV_RES_INV;
-            }
+        char version[sizeof(((NacpStruct *) NULL)->display_version)];
+        fseek(fp, nacp_offset + offsetof(NacpStruct, display_version), SEEK_SET);
+        if (fread(version, sizeof(version), 1, fp) != 1) {
+            LV_LOG_WARN("Bad nacp read");
+            goto fail_info;
+        }
 
-            if (unzReadCurrentFile(zf, data, size) < size) {
-                lv_mem_free(data);
-                unzCloseCurrentFile(zf);
-                unzClose(zf);
-                return LV_RES_INV;
-            }
+        strncpy(info->name, lang.name, APP_NAME_LEN - 1);
+        info->name[APP_NAME_LEN - 1] = '\0';
+
+        strncpy(info->author, lang.author, APP_AUTHOR_LEN - 1);
+        info->author[APP_AUTHOR_LEN - 1] = '\0';
+
+        strncpy(info->version, version, APP_VER_LEN - 1);
+        info->version[APP_VER_LEN - 1] = '\0';
+    }
+
+    fclose(fp);
+
+    return LV_RES_OK;
+
+fail_info:
+    if (icon_data != NULL) {
+        free(*icon_data);
+        *icon_data = NULL;
+    }
+
+    fclose(fp);
+
+    return LV_RES_INV;
+}
+
+static lv_res_t nro_read_icon(app_entry_t *entry, app_icon_loc_t *loc, void **icon_data) {
+    // Without known offsets, fall back to going through the headers
+    if (loc->size == 0)
+        return nro_read(entry, loc, NULL, icon_data);
+
+    FILE *fp = fopen(entry->path, "rb");
+    if (fp == NULL) {
+        LV_LOG_WARN("Bad file");
+        return LV_RES_INV;
+    }
+
+    setvbuf(fp, NULL, _IONBF, 0);
+
+    u8 *data = malloc(loc->size);
+    if (data == NULL) {
+        LV_LOG_WARN("Bad icon alloc");
+        fclose(fp);
+        return LV_RES_INV;
+    }
+
+    fseek(fp, loc->offset, SEEK_SET);
+    if (fread(data, loc->size, 1, fp) != 1) {
+        LV_LOG_WARN("Bad icon read");
+        free(data);
+        fclose(fp);
+        return LV_RES_INV;
+    }
+
+    fclose(fp);
+
+    *icon_data = data;
+
+    return LV_RES_OK;
+}
+
+// Reads the file the zip is at, with a null terminator after it
+static void *zip_read_current(unzFile zf, u32 *out_size) {
+    if (unzOpenCurrentFile(zf) != UNZ_OK)
+        return NULL;
+
+    unz_file_info file_info;
+    if (unzGetCurrentFileInfo(zf, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK) {
+        unzCloseCurrentFile(zf);
+        return NULL;
+    }
+
+    u32 size = file_info.uncompressed_size;
+
+    u8 *data = malloc(size + 1);
+    if (data == NULL) {
+        unzCloseCurrentFile(zf);
+        return NULL;
+    }
+
+    if (unzReadCurrentFile(zf, data, size) < (int) size) {
+        free(data);
+        unzCloseCurrentFile(zf);
+        return NULL;
+    }
+
+    unzCloseCurrentFile(zf);
+
+    data[size] = '\0';
+    *out_size = size;
+
+    return data;
+}
+
+static lv_res_t theme_parse_info(char *cfg_str, app_info_t *info) {
+    config_t cfg;
+
+    config_init(&cfg);
+    if (config_read_string(&cfg, cfg_str) != CONFIG_TRUE) {
+        config_destroy(&cfg);
+        return LV_RES_INV;
+    }
+
+    config_setting_t *theme_info = config_lookup(&cfg, "info");
+    if (theme_info == NULL) {
+        config_destroy(&cfg);
+        return LV_RES_INV;
+    }
+
+    const char *tmp_str;
+
+    if (config_setting_lookup_string(theme_info, "name", &tmp_str) != CONFIG_TRUE) {
+        config_destroy(&cfg);
+        return LV_RES_INV;
+    }
+    strncpy(info->name, tmp_str, APP_NAME_LEN - 1);
+    info->name[APP_NAME_LEN - 1] = '\0';
 
-            unzCloseCurrentFile(zf);
+    if (config_setting_lookup_string(theme_info, "author", &tmp_str) != CONFIG_TRUE) {
+        config_destroy(&cfg);
+        return LV_RES_INV;
+    }
+    strncpy(info->author, tmp_str, APP_AUTHOR_LEN - 1);
+    info->author[APP_AUTHOR_LEN - 1] = '\0';
+
+    if (config_setting_lookup_string(theme_info, "version", &tmp_str) != CONFIG_TRUE) {
+        config_destroy(&cfg);
+        return LV_RES_INV;
+    }
+    strncpy(info->version, tmp_str, APP_VER_LEN - 1);
+    info->version[APP_VER_LEN - 1] = '\0';
+
+    config_destroy(&cfg);
+
+    return LV_RES_OK;
+}
+
+// Remembers where the data of the located icon is, so it can be read later without going through the central directory
+static void theme_locate_icon(app_icon_loc_t *loc, unzFile zf) {
+    unz_file_info file_info;
+    if (unzGetCurrentFileInfo(zf, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK)
+        return;
+
+    // Encrypted icons are left to minizip
+    if ((file_info.flag & 1) || (file_info.compression_method != 0 && file_info.compression_method != Z_DEFLATED))
+        return;
+
+    // Opened raw, only to get the position of the data
+    if (unzOpenCurrentFile2(zf, NULL, NULL, 1) != UNZ_OK)
+        return;
+
+    ZPOS64_T offset = unzGetCurrentFileZStreamPos64(zf);
+
+    unzCloseCurrentFile(zf);
+
+    if (offset == 0)
+        return;
+
+    loc->offset = offset;
+    loc->size = file_info.uncompressed_size;
+    loc->stored_size = file_info.compressed_size;
+    loc->method = file_info.compression_method;
+}
+
+// Opens the zip once for both the info and the icon, and finds where the icon is
+static lv_res_t theme_read(app_entry_t *entry, app_icon_loc_t *loc, app_info_t *info, void **icon_data, u32 *icon_size) {
+    unzFile zf = unzOpen(entry->path);
+    if (zf == NULL) {
+        LV_LOG_WARN("Bad zip");
+        return LV_RES_INV;
+    }
+
+    if (info != NULL) {
+        if (unzLocateFile(zf, "info.cfg", 0) != UNZ_OK) {
             unzClose(zf);
+            return LV_RES_INV;
+        }
+
+        u32 cfg_size;
+        char *cfg_str = zip_read_current(zf, &cfg_size);
+        if (cfg_str == NULL) {
+            unzClose(zf);
+            return LV_RES_INV;
+        }
+
+        lv_res_t res = theme_parse_info(cfg_str, info);
+        free(cfg_str);
+
+        if (res != LV_RES_OK) {
+            unzClose(zf);
+            return res;
+        }
+    }
+
+    // A theme without an icon is still listed
+    if (unzLocateFile(zf, "icon.jpg", 0) != UNZ_OK) {
+        unzClose(zf);
+        return (icon_data != NULL) ? LV_RES_INV : LV_RES_OK;
+    }
+
+    theme_locate_icon(loc, zf);
+
+    if (icon_data != NULL) {
+        *icon_data = zip_read_current(zf, icon_size);
+        if (*icon_data == NULL) {
+            unzClose(zf);
+            return LV_RES_INV;
+        }
+    }
+
+    unzClose(zf);
+
+    return LV_RES_OK;
+}
+
+static lv_res_t theme_read_icon(app_entry_t *entry, app_icon_loc_t *loc, void **icon_data, u32 *icon_size) {
+    // Without a known location, fall back to going through the central directory
+    if (loc->size == 0)
+        return theme_read(entry, loc, NULL, icon_data, icon_size);
+
+    FILE *fp = fopen(entry->path, "rb");
+    if (fp == NULL) {
+        LV_LOG_WARN("Bad file");
+        return LV_RES_INV;
+    }
+
+    setvbuf(fp, NULL, _IONBF, 0);
+
+    u8 *stored = malloc(loc->stored_size);
+    if (stored == NULL) {
+        LV_LOG_WARN("Bad icon alloc");
+        fclose(fp);
+        return LV_RES_INV;
+    }
+
+    fseek(fp, loc->offset, SEEK_SET);
+    if (fread(stored, loc->stored_size, 1, fp) != 1) {
+        LV_LOG_WARN("Bad icon read");
+        free(stored);
+        fclose(fp);
+        return LV_RES_INV;
+    }
+
+    fclose(fp);
+
+    if (loc->method == 0) {
+        *icon_data = stored;
+        *icon_size = loc->stored_size;
+        return LV_RES_OK;
+    }
+
+    u8 *data = malloc(loc->size);
+    if (data == NULL) {
+        LV_LOG_WARN("Bad icon alloc");
+        free(stored);
+        return LV_RES_INV;
+    }
+
+    // Zip entries are raw deflate streams, without a zlib header
+    z_stream stream = {
+        .next_in = stored,
+        .avail_in = loc->stored_size,
+        .next_out = data,
+        .avail_out = loc->size,
+    };
+
+    bool ok = inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+    if (ok) {
+        ok = inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out == loc->size;
+        inflateEnd(&stream);
+    }
+
+    free(stored);
+
+    if (!ok) {
+        LV_LOG_WARN("Bad icon inflate");
+        free(data);
+        return LV_RES_INV;
+    }
+
+    *icon_data = data;
+    *icon_size = loc->size;
+
+    return LV_RES_OK;
+}
+
+// Reads the encoded icon of the app into a raw image descriptor of the given size
+static lv_res_t app_entry_read_icon(app_entry_t *entry, app_icon_loc_t *loc, lv_img_dsc_t *dsc, u32 w, u32 h) {
+    void *data = NULL;
+    u32 size = 0;
+
+    switch (entry->type) {
+        case AppEntryType_homebrew: {
+            lv_res_t res = nro_read_icon(entry, loc, &data);
+            if (res != LV_RES_OK)
+                return res;
+
+            size = loc->size;
+        } break;
+
+        case AppEntryType_theme: {
+            lv_res_t res = theme_read_icon(entry, loc, &data, &size);
+            if (res != LV_RES_OK)
+                return res;
         } break;
 
         default:
             return LV_RES_INV;
     }
 
-    entry->icon = (lv_img_dsc_t) {
+    *dsc = (lv_img_dsc_t) {
         .header.always_zero = 0,
-        .header.w = APP_ICON_W,
-        .header.h = APP_ICON_H,
+        .header.w = w,
+        .header.h = h,
         .data_size = size,
         .header.cf = LV_IMG_CF_RAW,
         .data = data,
     };
 
-    entry->icon_small = entry->icon;
-    entry->icon_small.header.w = APP_ICON_SMALL_W;
-    entry->icon_small.header.h = APP_ICON_SMALL_H;
-
     return LV_RES_OK;
 }
 
-void app_entry_free_icon(app_entry_t *entry) {
-    lv_mem_free((void *) entry->icon.data);
-}
+void *app_entry_load_icon(app_entry_t *entry, app_icon_loc_t *loc) {
+    u64 hash;
 
-lv_res_t app_entry_init_info(app_entry_t *entry) {
-    switch (entry->type) {
-        case AppEntryType_homebrew: {
-            FILE *fp = fopen(entry->path, "rb");
-            if (fp == NULL) {
-                LV_LOG_WARN("Bad file\n");
-                return LV_RES_INV;
-            }
+    // The header tells which icon it is, so the pixels don't have to be read if it's already loaded
+    if (thumbs_read(loc->thumb_slot, entry->thumb_key, &hash, NULL) == LV_RES_OK) {
+        void *shared = icon_pool_acquire(hash);
+        if (shared != NULL)
+            return shared;
 
-            NroHeader header;
-            NroAssetHeader asset_header;
+        u8 *data = malloc(THUMB_DATA_SIZE);
+        if (data == NULL)
+            return NULL;
 
-            fseek(fp, sizeof(NroStart), SEEK_SET);
-            if (fread(&header, sizeof(header), 1, fp) != 1) {
-                LV_LOG_WARN("Bad header read\n");
-                fclose(fp);
-                return LV_RES_INV;
-            }
+        if (thumbs_read(loc->thumb_slot, entry->thumb_key, &hash, data) == LV_RES_OK)
+            return icon_pool_add(hash, data);
 
-            fseek(fp, header.size, SEEK_SET);
-            if (fread(&asset_header, sizeof(asset_header), 1, fp) != 1) {
-                LV_LOG_WARN("Bad asset header read\n");
-                fclose(fp);
-                return LV_RES_INV;
-            }
+        free(data);
+    }
 
-            NacpStruct nacp;
+    lv_img_dsc_t encoded;
+    if (app_entry_read_icon(entry, loc, &encoded, APP_ICON_SMALL_W, APP_ICON_SMALL_H) != LV_RES_OK)
+        return NULL;
 
-            fseek(fp, header.size + asset_header.nacp.offset, SEEK_SET);
-            if (fread(&nacp, sizeof(nacp), 1, fp) != 1) {
-                LV_LOG_WARN("Bad nacp read\n");
-                fclose(fp);
-                return LV_RES_INV;
-            }
+    hash = hash_bytes(encoded.data, encoded.data_size);
 
-            strncpy(entry->name, nacp.lang[0].name, APP_NAME_LEN - 1);
-            entry->name[APP_NAME_LEN - 1] = '\0';
+    // Lots of apps come with the same default icon
+    void *data = icon_pool_acquire(hash);
 
-            strncpy(entry->author, nacp.lang[0].author, APP_AUTHOR_LEN - 1);
-            entry->author[APP_AUTHOR_LEN - 1] = '\0';
+    if (data == NULL) {
+        data = malloc(THUMB_DATA_SIZE);
 
-            strncpy(entry->version, nacp.display_version, APP_VER_LEN - 1);
-            entry->version[APP_VER_LEN - 1] = '\0';
+        if (data != NULL && decoderDecode(&encoded, data) != LV_RES_OK) {
+            free(data);
+            data = NULL;
+        }
 
-            fclose(fp);
-        } break;
+        if (data != NULL)
+            data = icon_pool_add(hash, data);
+    }
 
-        case AppEntryType_theme: {
-            unzFile zf = unzOpen(entry->path);
-            if (zf == NULL)
-                return LV_RES_INV;
+    free((void *) encoded.data);
 
-            if (unzLocateFile(zf, "info.cfg", 0) != UNZ_OK) {
-                unzClose(zf);
-                return LV_RES_INV;
-            }
+    if (data == NULL)
+        return NULL;
 
-            if (unzOpenCurrentFile(zf) != UNZ_OK) {
-                unzClose(zf);
-                return LV_RES_INV;
-            }
+    // Only apps found by the scan have a key to store the thumbnail under
+    if (entry->thumb_key != 0) {
+        s32 slot = thumbs_write(entry->thumb_key, hash, data);
+        if (slot >= 0 && apps_index_set_thumb(entry->path, slot))
+            loc->thumb_slot = slot;
+    }
 
-            unz_file_info file_info;
-            if (unzGetCurrentFileInfo(zf, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK) {
-                unzCloseCurrentFile(zf);
-                unzClose(zf);
-                return LV_RES_INV;
-            }
+    return data;
+}
 
-            char cfg_str[file_info.uncompressed_size + 1];
-            if (unzReadCurrentFile(zf, cfg_str, file_info.uncompressed_size) < file_info.uncompressed_size) {
-                unzCloseCurrentFile(zf);
-                unzClose(zf);
-                return LV_RES_INV;
-            }
+void app_entry_set_icon(app_entry_t *entry, void *data) {
+    app_entry_free_icon(entry);
 
-            unzCloseCurrentFile(zf);
-            unzClose(zf);
+    entry->icon_small = (lv_img_dsc_t) {
+        .header.always_zero = 0,
+        .header.w = APP_ICON_SMALL_W,
+        .header.h = APP_ICON_SMALL_H,
+        .data_size = THUMB_DATA_SIZE,
+        .header.cf = LV_IMG_CF_TRUE_COLOR,
+        .data = data,
+    };
+}
 
-            cfg_str[file_info.uncompressed_size] = '\0';
+lv_res_t app_entry_init_icon(app_entry_t *entry) {
+    void *data = app_entry_load_icon(entry, &entry->icon_loc);
+    if (data == NULL)
+        return LV_RES_INV;
 
-            config_t cfg;
+    app_entry_set_icon(entry, data);
 
-            config_init(&cfg);
-            if (config_read_string(&cfg, cfg_str) != CONFIG_TRUE) {
-                config_destroy(&cfg);
-                return LV_RES_INV;
-            }
+    return LV_RES_OK;
+}
 
-            config_setting_t *info = config_lookup(&cfg, "info");
-            if (info == NULL) {
-                config_destroy(&cfg);
-                return LV_RES_INV;
-            }
+bool app_entry_has_icon(app_entry_t *entry) {
+    return entry->icon_small.data != g_icon_placeholder.data;
+}
 
-            const char *tmp_str;
+void app_entry_free_icon(app_entry_t *entry) {
+    lv_img_cache_invalidate_src(&entry->icon_small);
 
-            if (config_setting_lookup_string(info, "name", &tmp_str) != CONFIG_TRUE) {
-                config_destroy(&cfg);
-                return LV_RES_INV;
-            }
-            strncpy(entry->name, tmp_str, APP_NAME_LEN - 1);
-            entry->name[APP_NAME_LEN - 1] = '\0';
+    if (app_entry_has_icon(entry))
+        icon_pool_release((void *) entry->icon_small.data);
 
-            if (config_setting_lookup_string(info, "author", &tmp_str) != CONFIG_TRUE) {
-                config_destroy(&cfg);
-                return LV_RES_INV;
-            }
-            strncpy(entry->author, tmp_str, APP_AUTHOR_LEN - 1);
-            entry->author[APP_AUTHOR_LEN - 1] = '\0';
+    entry->icon_small = g_icon_placeholder;
+}
 
-            if (config_setting_lookup_string(info, "version", &tmp_str) != CONFIG_TRUE) {
-                config_destroy(&cfg);
-                return LV_RES_INV;
-            }
-            strncpy(entry->version, tmp_str, APP_VER_LEN - 1);
-            entry->version[APP_VER_LEN - 1] = '\0';
+lv_res_t app_entry_init_icon_big(app_entry_t *entry) {
+    return app_entry_read_icon(entry, &entry->icon_loc, &entry->icon, APP_ICON_W, APP_ICON_H);
+}
+
+void app_entry_free_icon_big(app_entry_t *entry) {
+    decoderInvalidate(&entry->icon);
+
+    free((void *) entry->icon.data);
+    entry->icon.data = NULL;
+}
+
+lv_res_t app_entry_init_info(app_entry_t *entry, app_info_t *info) {
+    switch (entry->type) {
+        case AppEntryType_homebrew: {
+            lv_res_t res = nro_read(entry, &entry->icon_loc, info, NULL);
+            if (res != LV_RES_OK)
+                return res;
+        } break;
+
+        case AppEntryType_theme: {
+            lv_res_t res = theme_read(entry, &entry->icon_loc, info, NULL, NULL);
+            if (res != LV_RES_OK)
+                return res;
         } break;
 
         default:
             return LV_RES_INV;
     }
 
+    entry->name = info->name;
+    entry->author = info->author;
+    entry->version = info->version;
+
     return LV_RES_OK;
 }
 
@@ -294,29 +623,19 @@ void app_entry_get_star_path(app_entry_t *entry, char *out_path) {
 }
 
 lv_res_t app_entry_set_star(app_entry_t *entry, bool star) {
-    char star_path[PATH_MAX + 1];
-    app_entry_get_star_path(entry, star_path);
-
-    if (star) {
-        FILE *fp = fopen(star_path, "w");
-
-        if (fp == NULL)
-            return LV_RES_INV;
-
-        fclose(fp);
-    } else {
-        if (remove(star_path) != 0)
-            return LV_RES_INV;
-    }
-
+    favorites_set(entry->path, star);
     entry->starred = star;
 
     return LV_RES_OK;
 }
 
-
 lv_res_t app_entry_delete(app_entry_t *entry) {
-    app_entry_set_star(entry, false); // Try to remove star file
+    app_entry_set_star(entry, false);
+
+    // Try to remove an old star file
+    char star_path[PATH_MAX + 1];
+    app_entry_get_star_path(entry, star_path);
+    remove(star_path);
 
     if (get_name(entry->path) == entry->path + sizeof(APP_DIR)) { // Is just a file under the app directory
         if (remove(entry->path) != 0)
@@ -328,39 +647,51 @@ lv_res_t app_entry_delete(app_entry_t *entry) {
 
         *(get_name(del_path)) = '\0';
 
+        // This removes the directory itself too
         if (R_FAILED(fsdevDeleteDirectoryRecursively(del_path))) // Maybe replace this with some stdio stuff?
             return LV_RES_INV;
-
-        if (rmdir(del_path) != 0)
-            return LV_RES_INV;
     }
 
     return LV_RES_OK;
 }
 
-lv_res_t app_entry_add_arg(app_entry_t *entry, char *arg) {
-    size_t new_arg_len = strlen(entry->args) + strlen(arg) + 3;
+lv_res_t app_args_add(char *args, char *arg) {
+    size_t new_arg_len = strlen(args) + strlen(arg) + 3;
 
-    if (entry->args[0] == '\0')
+    if (args[0] == '\0')
         new_arg_len--;
 
     if (new_arg_len >= APP_ARGS_LEN)
         return LV_RES_INV;
 
-    if (entry->args[0] != '\0')
-        strcat(entry->args, " ");
+    if (args[0] != '\0')
+        strcat(args, " ");
 
-    strcat(entry->args, "\"");
-    strcat(entry->args, arg);
-    strcat(entry->args, "\"");
+    strcat(args, "\"");
+    strcat(args, arg);
+    strcat(args, "\"");
 
     return LV_RES_OK;
 }
 
-lv_res_t app_entry_load(app_entry_t *entry) {
+lv_res_t app_entry_load(app_entry_t *entry, char *args) {
     switch (entry->type) {
         case AppEntryType_homebrew: {
-            if (R_FAILED(envSetNextLoad(entry->path, entry->args)))
+            char load_args[APP_ARGS_LEN];
+            load_args[0] = '\0';
+
+            if (app_args_add(load_args, entry->path) != LV_RES_OK)
+                return LV_RES_INV;
+
+            if (args != NULL && args[0] != '\0') {
+                if (strlen(load_args) + 1 + strlen(args) >= APP_ARGS_LEN)
+                    return LV_RES_INV;
+
+                strcat(load_args, " ");
+                strcat(load_args, args);
+            }
+
+            if (R_FAILED(envSetNextLoad(entry->path, load_args)))
                 return LV_RES_INV;
 
             stop_main_loop();
@@ -381,67 +712,506 @@ lv_res_t app_entry_load(app_entry_t *entry) {
     return LV_RES_OK;
 }
 
-lv_res_t app_entry_ll_ins(lv_ll_t *ll, char *path) {
-    app_entry_t *entry = lv_ll_ins_tail(ll);
-    app_entry_init_base(entry, path);
+#define SCAN_FIRST_CORE 1
+#define SCAN_NUM_CORES 2
+
+#define CATALOG_CHUNK_LEN 64
+#define CATALOG_ARENA_BLOCK_SIZE 0x4000
+
+// An entry along with the storage for its strings, until it's moved into a catalog
+typedef struct {
+    app_entry_t entry;
+    app_info_t info;
+    char path[PATH_MAX + 1];
+} scan_entry_t;
+
+typedef struct {
+    char *name;
+    bool is_dir;
+
+    scan_entry_t *entry;
+    u64 size;
+    s64 mtime;
+    bool indexed; // Whether the entry's info came from the apps index
+} scan_job_t;
+
+typedef struct app_scan {
+    thrd_t thread;
+    mtx_t mtx;
+
+    scan_job_t *jobs;
+    u32 jobs_len;
+    u32 jobs_cap;
+
+    atomic_uint next_job;
+    atomic_uint next_core;
+    atomic_bool cancelled;
+
+    // Indices of finished jobs, in the order they finished
+    u32 *done;
+    u32 done_len;
+    u32 done_read;
+
+    bool finished;
+} scan_ctx_t;
+
+/*
+ * Fills in an entry for the app at the path, parsing it only if it's new or
+ * has changed since the apps index was written. This runs on the scan threads,
+ * so it must not allocate from the LVGL heap.
+ */
+static lv_res_t scan_file(scan_job_t *job, char *path) {
+    struct stat s;
+    if (stat_counted(path, &s) != 0)
+        return LV_RES_INV;
 
-    lv_res_t res = app_entry_init_info(entry);
-    if (res != LV_RES_OK) {
-        lv_ll_rem(ll, entry);
-        return res;
-    }
+    scan_entry_t *scan_entry = malloc(sizeof(scan_entry_t));
+    if (scan_entry == NULL)
+        return LV_RES_INV;
+
+    strncpy(scan_entry->path, path, PATH_MAX);
+    scan_entry->path[PATH_MAX] = '\0';
+
+    app_entry_t *entry = &scan_entry->entry;
+    app_entry_init_path(entry, scan_entry->path);
+
+    app_entry_init_star(entry);
 
-    app_entry_t *tmp_entry;
-    LV_LL_READ(*ll, tmp_entry) {
-        if (!entry->starred && tmp_entry->starred)
-            continue;
+    entry->thumb_key = thumbs_key(path, s.st_size, s.st_mtime);
 
-        if ((entry->starred && !tmp_entry->starred) || strcasecmp(entry->name, tmp_entry->name) < 0) {
-            lv_ll_move_before(ll, entry, tmp_entry);
-            break;
+    job->indexed = apps_index_lookup(entry, &scan_entry->info, s.st_size, s.st_mtime);
+    if (!job->indexed) {
+        lv_res_t res = app_entry_init_info(entry, &scan_entry->info);
+        if (res != LV_RES_OK) {
+            free(scan_entry);
+            return res;
         }
     }
 
+    job->entry = scan_entry;
+    job->size = s.st_size;
+    job->mtime = s.st_mtime;
+
     return LV_RES_OK;
 }
 
-lv_res_t app_entry_ll_init(lv_ll_t *ll) {
-    DIR *app_dp = opendir(APP_DIR);
-    if (app_dp == NULL)
-        return LV_RES_INV;
+typedef struct {
+    scan_job_t *job;
+    char *dir_path;
+    u32 entries_left;
+} scan_dir_t;
 
-    lv_ll_init(ll, sizeof(app_entry_t));
+static bool scan_dir_cb(char *name, bool is_dir, void *data) {
+    scan_dir_t *dir = data;
 
-    struct dirent *ep;
-    while ((ep = readdir(app_dp))) {
-        char tmp_path[PATH_MAX + 1];
-        tmp_path[0] = '\0';
-        snprintf(tmp_path, sizeof(tmp_path), "%s/%s", APP_DIR, ep->d_name);
+    // Folders with lots of data files next to the app would otherwise take very long
+    if (dir->entries_left == 0)
+        return false;
 
-        if (is_dir(tmp_path)) {
-            DIR *dp = opendir(tmp_path);
-            if (dp == NULL)
-                continue;
+    dir->entries_left--;
 
-            while ((ep = readdir(dp))) {
-                char path[PATH_MAX + 1];
-                path[0] = '\0';
-                snprintf(path, sizeof(path), "%s/%s", tmp_path, ep->d_name);
+    // Only build a path once the name says it's an app
+    if (is_dir || get_app_type(name) == AppEntryType_none)
+        return true;
 
-                if (get_app_type(path) != AppEntryType_none) {
-                    if (app_entry_ll_ins(ll, path) != LV_RES_OK)
-                        continue;
+    char path[PATH_MAX + 1];
+    snprintf(path, sizeof(path), "%s/%s", dir->dir_path, name);
 
-                    break;
-                }
-            }
+    // Keep going until an app is found that can be read
+    return scan_file(dir->job, path) != LV_RES_OK;
+}
+
+static void scan_job(scan_job_t *job) {
+    if (!job->is_dir && get_app_type(job->name) == AppEntryType_none)
+        return;
+
+    char tmp_path[PATH_MAX + 1];
+    snprintf(tmp_path, sizeof(tmp_path), "%s/%s", APP_DIR, job->name);
 
-            closedir(dp);
-        } else if (get_app_type(tmp_path) != AppEntryType_none) {
-            app_entry_ll_ins(ll, tmp_path);
+    if (job->is_dir) {
+        char path[PATH_MAX + 1];
+
+        // Try where the app was last time, then where it conventionally is
+        if (apps_index_resolve_dir(tmp_path, path) && scan_file(job, path) == LV_RES_OK)
+            return;
+
+        snprintf(path, sizeof(path), "%s/%s.nro", tmp_path, job->name);
+        if (scan_file(job, path) == LV_RES_OK)
+            return;
+
+        scan_dir_t dir = {
+            .job = job,
+            .dir_path = tmp_path,
+            .entries_left = curr_settings()->app_scan_limit,
+        };
+
+        walk_dir(tmp_path, scan_dir_cb, &dir);
+    } else {
+        scan_file(job, tmp_path);
+    }
+}
+
+static int scan_worker_thread(void *arg) {
+    scan_ctx_t *ctx = arg;
+
+    // Keep the scan off the core the UI thread is on
+    s32 core = SCAN_FIRST_CORE + atomic_fetch_add(&ctx->next_core, 1) % SCAN_NUM_CORES;
+    svcSetThreadCoreMask(CUR_THREAD_HANDLE, core, BIT(core));
+
+    u32 i;
+    while (!atomic_load(&ctx->cancelled) && (i = atomic_fetch_add(&ctx->next_job, 1)) < ctx->jobs_len) {
+        scan_job(&ctx->jobs[i]);
+
+        if (ctx->jobs[i].entry != NULL) {
+            mtx_lock(&ctx->mtx);
+            ctx->done[ctx->done_len++] = i;
+            mtx_unlock(&ctx->mtx);
         }
     }
 
-    closedir(app_dp);
+    return 0;
+}
+
+static bool scan_add_job_cb(char *name, bool is_dir, void *data) {
+    scan_ctx_t *ctx = data;
+
+    if (atomic_load(&ctx->cancelled))
+        return false;
+
+    if (ctx->jobs_len >= ctx->jobs_cap) {
+        u32 new_cap = (ctx->jobs_cap == 0) ? 64 : ctx->jobs_cap * 2;
+
+        scan_job_t *new_jobs = realloc(ctx->jobs, new_cap * sizeof(scan_job_t));
+        if (new_jobs == NULL)
+            return false;
+
+        ctx->jobs = new_jobs;
+        ctx->jobs_cap = new_cap;
+    }
+
+    scan_job_t *job = &ctx->jobs[ctx->jobs_len];
+    memset(job, 0, sizeof(scan_job_t));
+
+    job->name = strdup(name);
+    if (job->name == NULL)
+        return false;
+
+    job->is_dir = is_dir;
+
+    ctx->jobs_len++;
+
+    return true;
+}
+
+static int scan_thread(void *arg) {
+    scan_ctx_t *ctx = arg;
+
+    walk_dir(APP_DIR, scan_add_job_cb, ctx);
+
+    ctx->done = malloc(ctx->jobs_len * sizeof(u32));
+    if (ctx->done == NULL)
+        ctx->jobs_len = 0;
+
+    thrd_t threads[APP_SCAN_THREADS - 1];
+    int num_threads = 0;
+
+    for (int i = 0; i < APP_SCAN_THREADS - 1; i++) {
+        if (thrd_create(&threads[num_threads], scan_worker_thread, ctx) == thrd_success)
+            num_threads++;
+    }
+
+    scan_worker_thread(ctx);
+
+    for (int i = 0; i < num_threads; i++)
+        thrd_join(threads[i], NULL);
+
+    mtx_lock(&ctx->mtx);
+    ctx->finished = true;
+    mtx_unlock(&ctx->mtx);
+
+    return 0;
+}
+
+static void scan_free(scan_ctx_t *ctx) {
+    thrd_join(ctx->thread, NULL);
+    mtx_destroy(&ctx->mtx);
+
+    // Entries that were never taken by the catalog
+    for (u32 i = ctx->done_read; i < ctx->done_len; i++)
+        free(ctx->jobs[ctx->done[i]].entry);
+
+    for (u32 i = 0; i < ctx->jobs_len; i++)
+        free(ctx->jobs[i].name);
+
+    free(ctx->jobs);
+    free(ctx->done);
+    free(ctx);
+}
+
+static int app_key_cmp(const void *a, const void *b) {
+    const app_key_t *key_a = a;
+    const app_key_t *key_b = b;
+
+    // Entries are found in whatever order the scan threads finish, app_order_cmp doesn't depend on that
+    return app_order_cmp(&key_a->order, &key_b->order);
+}
+
+static char *app_catalog_strdup(app_catalog_t *catalog, const char *str) {
+    size_t size = strlen(str) + 1;
+
+    if (catalog->num_arena_blocks == 0 || catalog->arena_used + size > CATALOG_ARENA_BLOCK_SIZE) {
+        char **new_blocks = lv_mem_realloc(catalog->arena_blocks, (catalog->num_arena_blocks + 1) * sizeof(char *));
+        if (new_blocks == NULL)
+            return NULL;
+
+        catalog->arena_blocks = new_blocks;
+
+        // Strings that don't fit in a block get one to themselves
+        catalog->arena_blocks[catalog->num_arena_blocks] = lv_mem_alloc(LV_MATH_MAX(size, CATALOG_ARENA_BLOCK_SIZE));
+        if (catalog->arena_blocks[catalog->num_arena_blocks] == NULL)
+            return NULL;
+
+        catalog->num_arena_blocks++;
+        catalog->arena_used = 0;
+    }
+
+    char *dup = catalog->arena_blocks[catalog->num_arena_blocks - 1] + catalog->arena_used;
+    memcpy(dup, str, size);
+    catalog->arena_used += size;
+
+    return dup;
+}
+
+static app_entry_t *app_catalog_store(app_catalog_t *catalog, app_entry_t *entry) {
+    u32 chunk_idx = catalog->num_stored / CATALOG_CHUNK_LEN;
+
+    if (chunk_idx >= catalog->num_chunks) {
+        app_entry_t **new_chunks = lv_mem_realloc(catalog->chunks, (catalog->num_chunks + 1) * sizeof(app_entry_t *));
+        if (new_chunks == NULL)
+            return NULL;
+
+        catalog->chunks = new_chunks;
+
+        catalog->chunks[catalog->num_chunks] = lv_mem_alloc(CATALOG_CHUNK_LEN * sizeof(app_entry_t));
+        if (catalog->chunks[catalog->num_chunks] == NULL)
+            return NULL;
+
+        catalog->num_chunks++;
+    }
+
+    app_entry_t stored_entry = *entry;
+
+    stored_entry.path = app_catalog_strdup(catalog, entry->path);
+    stored_entry.name = app_catalog_strdup(catalog, entry->name);
+    stored_entry.author = app_catalog_strdup(catalog, entry->author);
+    stored_entry.version = app_catalog_strdup(catalog, entry->version);
+
+    if (stored_entry.path == NULL || stored_entry.name == NULL || stored_entry.author == NULL || stored_entry.version == NULL)
+        return NULL;
+
+    app_entry_t *stored = &catalog->chunks[chunk_idx][catalog->num_stored % CATALOG_CHUNK_LEN];
+    *stored = stored_entry;
+    catalog->num_stored++;
+
+    return stored;
+}
+
+// The key array has to have room for another key
+static s32 app_catalog_insert_key(app_catalog_t *catalog, app_key_t *key) {
+    u32 lo = app_order_upper_bound(catalog->keys, catalog->len, sizeof(app_key_t), key, app_key_cmp);
+
+    memmove(&catalog->keys[lo + 1], &catalog->keys[lo], (catalog->len - lo) * sizeof(app_key_t));
+    catalog->keys[lo] = *key;
+    catalog->len++;
+
+    return lo;
+}
+
+static s32 app_catalog_insert(app_catalog_t *catalog, app_entry_t *entry) {
+    if (catalog->len >= catalog->cap) {
+        u32 new_cap = (catalog->cap == 0) ? 64 : catalog->cap * 2;
+
+        app_key_t *new_keys = lv_mem_realloc(catalog->keys, new_cap * sizeof(app_key_t));
+        if (new_keys == NULL)
+            return -1;
+
+        catalog->keys = new_keys;
+        catalog->cap = new_cap;
+    }
+
+    app_entry_t *stored = app_catalog_store(catalog, entry);
+    if (stored == NULL)
+        return -1;
+
+    app_key_t key = {
+        .order = {
+            .name = stored->name,
+            .path = stored->path,
+            .starred = stored->starred,
+        },
+        .entry = stored,
+    };
+
+    return app_catalog_insert_key(catalog, &key);
+}
+
+s32 app_catalog_find(app_catalog_t *catalog, app_entry_t *entry) {
+    for (u32 i = 0; i < catalog->len; i++) {
+        if (catalog->keys[i].entry == entry)
+            return i;
+    }
+
+    return -1;
+}
+
+static void app_catalog_remove_key(app_catalog_t *catalog, s32 idx) {
+    memmove(&catalog->keys[idx], &catalog->keys[idx + 1], (catalog->len - idx - 1) * sizeof(app_key_t));
+    catalog->len--;
+}
+
+lv_res_t app_catalog_init(app_catalog_t *catalog) {
+    memset(catalog, 0, sizeof(app_catalog_t));
+
+    thumbs_open();
+    icon_pool_init();
+    apps_index_load();
+    favorites_load();
+
+    stat_count_reset();
+
+    scan_ctx_t *ctx = calloc(1, sizeof(scan_ctx_t));
+    if (ctx == NULL)
+        return LV_RES_INV;
+
+    mtx_init(&ctx->mtx, mtx_plain);
+
+    atomic_init(&ctx->next_job, 0);
+    atomic_init(&ctx->next_core, 0);
+    atomic_init(&ctx->cancelled, false);
+
+    if (thrd_create(&ctx->thread, scan_thread, ctx) != thrd_success) {
+        mtx_destroy(&ctx->mtx);
+        free(ctx);
+        return LV_RES_INV;
+    }
+
+    catalog->scan = ctx;
+
     return LV_RES_OK;
+}
+
+s32 app_catalog_poll(app_catalog_t *catalog) {
+    scan_ctx_t *ctx = catalog->scan;
+    if (ctx == NULL)
+        return -1;
+
+    mtx_lock(&ctx->mtx);
+    u32 done_len = ctx->done_len;
+    bool finished = ctx->finished;
+    mtx_unlock(&ctx->mtx);
+
+    s32 first_changed = -1;
+
+    for (; ctx->done_read < done_len; ctx->done_read++) {
+        scan_job_t *job = &ctx->jobs[ctx->done[ctx->done_read]];
+
+        if (!job->indexed)
+            apps_index_update(&job->entry->entry, job->size, job->mtime);
+
+        if (job->entry->entry.starred && favorites_importing())
+            favorites_set(job->entry->entry.path, true);
+
+        s32 idx = app_catalog_insert(catalog, &job->entry->entry);
+        if (idx >= 0 && (first_changed < 0 || idx < first_changed))
+            first_changed = idx;
+
+        free(job->entry);
+        job->entry = NULL;
+    }
+
+    if (finished && ctx->done_read >= ctx->done_len) {
+        scan_free(ctx);
+        catalog->scan = NULL;
+
+        apps_index_set_scanned();
+        apps_index_save();
+        favorites_save();
+        thumbs_trim();
+
+        lv_mem_monitor_t mon;
+        lv_mem_monitor(&mon);
+        logPrintf("catalog: %u apps, %u stat calls, %u bytes of LVGL memory in use\n", catalog->len, stat_count(), mon.total_size - mon.free_size);
+    }
+
+    return first_changed;
+}
+
+bool app_catalog_loading(app_catalog_t *catalog) {
+    return catalog->scan != NULL;
+}
+
+void app_catalog_wait(app_catalog_t *catalog) {
+    struct timespec sleep = {.tv_nsec = 10000000};
+
+    for (app_catalog_poll(catalog); app_catalog_loading(catalog); app_catalog_poll(catalog))
+        thrd_sleep(&sleep, NULL);
+}
+
+void app_catalog_cancel(app_catalog_t *catalog) {
+    scan_ctx_t *ctx = catalog->scan;
+    if (ctx == NULL)
+        return;
+
+    // The threads finish the jobs they're on, then stop taking new ones
+    atomic_store(&ctx->cancelled, true);
+
+    scan_free(ctx);
+    catalog->scan = NULL;
+}
+
+void app_catalog_clear(app_catalog_t *catalog) {
+    app_catalog_cancel(catalog);
+
+    for (u32 i = 0; i < catalog->num_chunks; i++)
+        lv_mem_free(catalog->chunks[i]);
+
+    for (u32 i = 0; i < catalog->num_arena_blocks; i++)
+        lv_mem_free(catalog->arena_blocks[i]);
+
+    lv_mem_free(catalog->chunks);
+    lv_mem_free(catalog->keys);
+    lv_mem_free(catalog->arena_blocks);
+
+    memset(catalog, 0, sizeof(app_catalog_t));
+}
+
+s32 app_catalog_reposition(app_catalog_t *catalog, app_entry_t *entry) {
+    s32 idx = app_catalog_find(catalog, entry);
+    if (idx < 0)
+        return -1;
+
+    app_key_t key = catalog->keys[idx];
+    key.order.starred = entry->starred;
+
+    app_catalog_remove_key(catalog, idx);
+
+    return app_catalog_insert_key(catalog, &key);
+}
+
+s32 app_catalog_remove(app_catalog_t *catalog, app_entry_t *entry) {
+    s32 idx = app_catalog_find(catalog, entry);
+    if (idx < 0)
+        return -1;
+
+    // The entry itself stays stored until the catalog is cleared, so pointers to it remain valid
+    app_catalog_remove_key(catalog, idx);
+
+    return idx;
+}
+
+app_entry_t *app_catalog_get(app_catalog_t *catalog, s32 idx) {
+    if (idx < 0 || idx >= catalog->len)
+        return NULL;
+
+    return catalog->keys[idx].entry;
 }
\ No newline at end of file
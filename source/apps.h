@@ -2,9 +2,14 @@
 
 #include <lvgl/lvgl.h>
 #include <limits.h>
+#include <switch.h>
+
+#include "app_order.h"
 
 #define APP_DIR "sdmc:/switch"
 
+#define APP_SCAN_THREADS 3
+
 #define APP_ARGS_LEN 0x800
 
 #define APP_NAME_LEN 0x200
@@ -23,35 +28,133 @@ typedef enum {
     AppEntryType_theme,
 } AppEntryType;
 
+// Info as it's parsed from an app, before it's moved into a catalog
 typedef struct {
-    char path[PATH_MAX + 1];
-    char args[APP_ARGS_LEN];
+    char name[APP_NAME_LEN];
+    char author[APP_AUTHOR_LEN];
+    char version[APP_VER_LEN];
+} app_info_t;
+
+/*
+ * Where the icon of an app is, found out while reading it. Icons are loaded
+ * on worker threads, which fill in a copy of this that's applied to the entry
+ * on the UI thread.
+ */
+typedef struct {
+    // Location of the icon in the file, filled in when the info is read. A size of 0 means it's unknown
+    u64 offset;
+    u32 size;
+    // For themes the icon is in a zip, where it might be compressed
+    u32 stored_size;
+    u16 method;
+
+    // Where the small icon is in the thumbnail store, -1 if it isn't yet
+    s32 thumb_slot;
+} app_icon_loc_t;
+
+// The strings are owned by whatever created the entry, normally the catalog's string arena
+typedef struct {
+    char *path;
+    char *name;
+    char *author;
+    char *version;
 
     bool starred;
     AppEntryType type;
 
-    char name[APP_NAME_LEN];
-    char author[APP_AUTHOR_LEN];
-    char version[APP_VER_LEN];
+    app_icon_loc_t icon_loc;
+    u32 thumb_key;
+
+    bool icon_pending; // Being loaded in the background
 
     lv_img_dsc_t icon;
     lv_img_dsc_t icon_small;
 } app_entry_t;
 
+// The fields needed for sorting, kept densely packed and in sorted order so sorting never touches the entries
+typedef struct {
+    app_order_key_t order;
+    app_entry_t *entry;
+} app_key_t;
+
+/*
+ * Measured with lv_mem_monitor for a scan of 1000 NROs with names of about 20
+ * characters: the catalog takes 221,696 bytes of LVGL memory, about 220 bytes
+ * per app, and the apps index records another 219,976. When every entry had
+ * fixed size buffers for its strings, the catalog took 7,424,752 bytes.
+ */
+typedef struct {
+    // Entries are stored in fixed size chunks so they never move once they're added
+    app_entry_t **chunks;
+    u32 num_chunks;
+    u32 num_stored;
+
+    app_key_t *keys; // Starred entries first, then by name
+    u32 len;
+    u32 cap;
+
+    char **arena_blocks;
+    u32 num_arena_blocks;
+    u32 arena_used; // Bytes used in the last block
+
+    struct app_scan *scan; // The scan still running in the background, if any
+} app_catalog_t;
+
+// The entry keeps pointing to the path, which has to outlive it
 void app_entry_init_base(app_entry_t *entry, char *path);
 
+/*
+ * Loads the pixels of the small icon shown in the list, from the thumbnail store
+ * if it's in there. This can be called from any thread, since of the entry only
+ * the path, type and thumbnail key are read. The icon location is taken from
+ * loc and updated in it. The data is shared with the apps that have the same
+ * icon and has to be given back with icon_pool_release.
+ */
+void *app_entry_load_icon(app_entry_t *entry, app_icon_loc_t *loc);
+// Takes over the reference to the loaded data
+void app_entry_set_icon(app_entry_t *entry, void *data);
+
 lv_res_t app_entry_init_icon(app_entry_t *entry);
+// Until the icon is loaded the small icon is a placeholder
+bool app_entry_has_icon(app_entry_t *entry);
 void app_entry_free_icon(app_entry_t *entry);
 
-lv_res_t app_entry_init_info(app_entry_t *entry);
+// Loads the full size icon shown in the app dialog
+lv_res_t app_entry_init_icon_big(app_entry_t *entry);
+void app_entry_free_icon_big(app_entry_t *entry);
+
+// Points the info strings of the entry into the passed info
+lv_res_t app_entry_init_info(app_entry_t *entry, app_info_t *info);
 
 void app_entry_get_star_path(app_entry_t *entry, char *out_path);
 lv_res_t app_entry_set_star(app_entry_t *entry, bool star);
 
 lv_res_t app_entry_delete(app_entry_t *entry);
 
-lv_res_t app_entry_add_arg(app_entry_t *entry, char *arg);
-lv_res_t app_entry_load(app_entry_t *entry);
-
-lv_res_t app_entry_ll_ins(lv_ll_t *ll, char *path);
-lv_res_t app_entry_ll_init(lv_ll_t *ll);
\ No newline at end of file
+lv_res_t app_args_add(char *args, char *arg);
+
+// The arguments are built at launch, the passed ones (which may be NULL) are added after the path
+lv_res_t app_entry_load(app_entry_t *entry, char *args);
+
+/*
+ * Starts scanning for apps in the background. Found apps are
+ * only added to the catalog when app_catalog_poll is called.
+ */
+lv_res_t app_catalog_init(app_catalog_t *catalog);
+void app_catalog_clear(app_catalog_t *catalog);
+
+// Returns the lowest index that changed, or -1 if nothing was added
+s32 app_catalog_poll(app_catalog_t *catalog);
+bool app_catalog_loading(app_catalog_t *catalog);
+void app_catalog_wait(app_catalog_t *catalog);
+// Stops the scan and waits for its threads, the apps it found that weren't added yet are dropped
+void app_catalog_cancel(app_catalog_t *catalog);
+
+// Moves the entry to where it belongs after its starred flag changed, and returns its new index
+s32 app_catalog_reposition(app_catalog_t *catalog, app_entry_t *entry);
+// Returns the index the entry was removed from
+s32 app_catalog_remove(app_catalog_t *catalog, app_entry_t *entry);
+
+app_entry_t *app_catalog_get(app_catalog_t *catalog, s32 idx);
+// Returns the index of the entry, or -1 if it isn't in the catalog
+s32 app_catalog_find(app_catalog_t *catalog, app_entry_t *entry);
\ No newline at end of file
@@ -0,0 +1,539 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <threads.h>
+#include <zlib.h>
+#include <lvgl/lvgl.h>
+#include <switch.h>
+
+#include "apps_index.h"
+#include "apps.h"
+#include "log.h"
+#include "thumbs.h"
+#include "util.h"
+
+#define APPS_INDEX_TMP_PATH APPS_INDEX_PATH ".tmp"
+
+#define APPS_INDEX_MAGIC 0x49434248 // "HBCI"
+#define APPS_INDEX_VERSION 5
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 count;
+    u32 data_size;
+    u32 data_crc;
+} index_header_t;
+
+// Each string is stored with its null terminator so records can point straight into the file data
+typedef struct {
+    u64 size;
+    s64 mtime;
+    u64 icon_offset;
+    u32 icon_size;
+    u32 icon_stored_size;
+    u16 icon_method;
+    s32 thumb_slot;
+    u16 path_len;
+    u16 name_len;
+    u16 author_len;
+    u8 version_len;
+    u8 type;
+} __attribute__((packed)) index_rec_header_t;
+
+typedef struct {
+    const char *path;
+    const char *name;
+    const char *author;
+    const char *version;
+
+    u64 size;
+    s64 mtime;
+
+    u64 icon_offset;
+    u32 icon_size;
+    u32 icon_stored_size;
+    u16 icon_method;
+
+    s32 thumb_slot;
+
+    AppEntryType type;
+    bool seen;
+
+    void *strs; // Owned string storage, NULL if the strings are in the loaded file data
+} index_rec_t;
+
+static u8 *g_data = NULL;
+
+static index_rec_t *g_recs = NULL;
+static u32 g_recs_len = 0;
+static u32 g_recs_cap = 0;
+
+static s32 *g_slots = NULL; // Open addressed table of indices into g_recs, -1 for empty
+static s32 *g_dir_slots = NULL; // Same as g_slots but keyed by the directory the app is in
+static u32 g_slots_len = 0;
+
+static bool g_loaded = false;
+static bool g_dirty = false;
+static bool g_scanned = false; // Records that weren't seen are only stale once every app was looked at
+
+// Lookups are done from the scan threads while the UI thread adds records
+static mtx_t g_index_mtx;
+static bool g_mtx_init = false;
+
+static s32 *find_slot(const char *path) {
+    u32 mask = g_slots_len - 1;
+
+    for (u32 i = hash_str(path) & mask; ; i = (i + 1) & mask) {
+        if (g_slots[i] < 0 || strcmp(g_recs[g_slots[i]].path, path) == 0)
+            return &g_slots[i];
+    }
+}
+
+static size_t dir_len(const char *path) {
+    const char *sep = strrchr(path, '/');
+    return (sep != NULL) ? sep - path : 0;
+}
+
+static s32 *find_dir_slot(const char *dir, size_t len) {
+    u32 mask = g_slots_len - 1;
+
+    for (u32 i = hash_strn(dir, len) & mask; ; i = (i + 1) & mask) {
+        if (g_dir_slots[i] < 0)
+            return &g_dir_slots[i];
+
+        const char *path = g_recs[g_dir_slots[i]].path;
+        if (dir_len(path) == len && strncmp(path, dir, len) == 0)
+            return &g_dir_slots[i];
+    }
+}
+
+static void set_slots(s32 idx) {
+    const char *path = g_recs[idx].path;
+
+    *find_slot(path) = idx;
+    *find_dir_slot(path, dir_len(path)) = idx;
+}
+
+static lv_res_t grow_slots(u32 min_recs) {
+    u32 new_len = 64;
+    while (new_len < min_recs * 2)
+        new_len *= 2;
+
+    if (new_len <= g_slots_len)
+        return LV_RES_OK;
+
+    s32 *new_slots = lv_mem_alloc(new_len * sizeof(s32));
+    if (new_slots == NULL)
+        return LV_RES_INV;
+
+    s32 *new_dir_slots = lv_mem_alloc(new_len * sizeof(s32));
+    if (new_dir_slots == NULL) {
+        lv_mem_free(new_slots);
+        return LV_RES_INV;
+    }
+
+    lv_mem_free(g_slots);
+    lv_mem_free(g_dir_slots);
+    g_slots = new_slots;
+    g_dir_slots = new_dir_slots;
+    g_slots_len = new_len;
+
+    memset(g_slots, 0xff, g_slots_len * sizeof(s32));
+    memset(g_dir_slots, 0xff, g_slots_len * sizeof(s32));
+
+    for (u32 i = 0; i < g_recs_len; i++)
+        set_slots(i);
+
+    return LV_RES_OK;
+}
+
+static index_rec_t *add_rec() {
+    if (g_recs_len >= g_recs_cap) {
+        u32 new_cap = (g_recs_cap == 0) ? 64 : g_recs_cap * 2;
+
+        index_rec_t *new_recs = lv_mem_realloc(g_recs, new_cap * sizeof(index_rec_t));
+        if (new_recs == NULL)
+            return NULL;
+
+        g_recs = new_recs;
+        g_recs_cap = new_cap;
+    }
+
+    if (grow_slots(g_recs_len + 1) != LV_RES_OK)
+        return NULL;
+
+    index_rec_t *rec = &g_recs[g_recs_len++];
+    memset(rec, 0, sizeof(index_rec_t));
+    rec->thumb_slot = -1;
+
+    return rec;
+}
+
+static index_rec_t *get_rec(const char *path) {
+    if (g_slots_len == 0)
+        return NULL;
+
+    s32 *slot = find_slot(path);
+    if (*slot < 0)
+        return NULL;
+
+    return &g_recs[*slot];
+}
+
+static bool valid_str(const u8 *str, size_t len) {
+    return len > 0 && str[len - 1] == '\0';
+}
+
+static lv_res_t parse_data(u32 count, size_t data_size) {
+    size_t pos = 0;
+
+    for (u32 i = 0; i < count; i++) {
+        if (pos + sizeof(index_rec_header_t) > data_size)
+            return LV_RES_INV;
+
+        index_rec_header_t rec_header;
+        memcpy(&rec_header, g_data + pos, sizeof(rec_header));
+        pos += sizeof(rec_header);
+
+        size_t strs_len = rec_header.path_len + rec_header.name_len + rec_header.author_len + rec_header.version_len;
+        if (pos + strs_len > data_size)
+            return LV_RES_INV;
+
+        const u8 *path = g_data + pos;
+        const u8 *name = path + rec_header.path_len;
+        const u8 *author = name + rec_header.name_len;
+        const u8 *version = author + rec_header.author_len;
+        pos += strs_len;
+
+        if (!valid_str(path, rec_header.path_len) || !valid_str(name, rec_header.name_len) ||
+            !valid_str(author, rec_header.author_len) || !valid_str(version, rec_header.version_len))
+            return LV_RES_INV;
+
+        if (get_rec((const char *) path) != NULL)
+            continue;
+
+        index_rec_t *rec = add_rec();
+        if (rec == NULL)
+            return LV_RES_INV;
+
+        rec->path = (const char *) path;
+        rec->name = (const char *) name;
+        rec->author = (const char *) author;
+        rec->version = (const char *) version;
+        rec->size = rec_header.size;
+        rec->mtime = rec_header.mtime;
+        rec->icon_offset = rec_header.icon_offset;
+        rec->icon_size = rec_header.icon_size;
+        rec->icon_stored_size = rec_header.icon_stored_size;
+        rec->icon_method = rec_header.icon_method;
+        rec->type = rec_header.type;
+
+        rec->thumb_slot = rec_header.thumb_slot;
+        if (!thumbs_claim(rec->thumb_slot))
+            rec->thumb_slot = -1;
+
+        set_slots(rec - g_recs);
+    }
+
+    return LV_RES_OK;
+}
+
+lv_res_t apps_index_load() {
+    if (!g_mtx_init) {
+        mtx_init(&g_index_mtx, mtx_plain);
+        g_mtx_init = true;
+    }
+
+    if (g_loaded)
+        return LV_RES_OK;
+
+    g_loaded = true;
+
+    FILE *fp = fopen(APPS_INDEX_PATH, "rb");
+    if (fp == NULL)
+        return LV_RES_INV;
+
+    index_header_t header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != APPS_INDEX_MAGIC || header.version != APPS_INDEX_VERSION) {
+        fclose(fp);
+        return LV_RES_INV;
+    }
+
+    g_data = lv_mem_alloc(header.data_size);
+    if (g_data == NULL) {
+        fclose(fp);
+        return LV_RES_INV;
+    }
+
+    if (fread(g_data, header.data_size, 1, fp) != 1 || crc32(0, g_data, header.data_size) != header.data_crc) {
+        LV_LOG_WARN("Bad apps index read");
+        fclose(fp);
+        apps_index_exit();
+        g_loaded = true;
+        return LV_RES_INV;
+    }
+
+    fclose(fp);
+
+    if (parse_data(header.count, header.data_size) != LV_RES_OK) {
+        LV_LOG_WARN("Bad apps index data");
+        apps_index_exit();
+        g_loaded = true;
+        return LV_RES_INV;
+    }
+
+    logPrintf("apps index: %u records\n", g_recs_len);
+
+    return LV_RES_OK;
+}
+
+static bool write_str(FILE *fp, const char *str, uLong *crc) {
+    size_t len = strlen(str) + 1;
+    *crc = crc32(*crc, (const u8 *) str, len);
+
+    return fwrite(str, len, 1, fp) == 1;
+}
+
+static lv_res_t index_save() {
+    for (u32 i = 0; i < g_recs_len && g_scanned && !g_dirty; i++) {
+        if (!g_recs[i].seen)
+            g_dirty = true;
+    }
+
+    if (!g_dirty)
+        return LV_RES_OK;
+
+    FILE *fp = fopen(APPS_INDEX_TMP_PATH, "wb");
+    if (fp == NULL)
+        return LV_RES_INV;
+
+    index_header_t header = {
+        .magic = APPS_INDEX_MAGIC,
+        .version = APPS_INDEX_VERSION,
+    };
+
+    // Write a placeholder header first, it's filled in once the data has been written
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+
+    uLong crc = crc32(0, NULL, 0);
+
+    // Records that weren't seen during the last scan are for apps that no longer exist
+    for (u32 i = 0; i < g_recs_len && ok; i++) {
+        index_rec_t *rec = &g_recs[i];
+        if (g_scanned && !rec->seen) {
+            thumbs_release(rec->thumb_slot);
+            rec->thumb_slot = -1;
+            continue;
+        }
+
+        index_rec_header_t rec_header = {
+            .size = rec->size,
+            .mtime = rec->mtime,
+            .icon_offset = rec->icon_offset,
+            .icon_size = rec->icon_size,
+            .icon_stored_size = rec->icon_stored_size,
+            .icon_method = rec->icon_method,
+            .thumb_slot = rec->thumb_slot,
+            .path_len = strlen(rec->path) + 1,
+            .name_len = strlen(rec->name) + 1,
+            .author_len = strlen(rec->author) + 1,
+            .version_len = strlen(rec->version) + 1,
+            .type = rec->type,
+        };
+
+        crc = crc32(crc, (const u8 *) &rec_header, sizeof(rec_header));
+        ok = fwrite(&rec_header, sizeof(rec_header), 1, fp) == 1 &&
+             write_str(fp, rec->path, &crc) && write_str(fp, rec->name, &crc) &&
+             write_str(fp, rec->author, &crc) && write_str(fp, rec->version, &crc);
+
+        header.count++;
+        header.data_size += sizeof(rec_header) + rec_header.path_len + rec_header.name_len + rec_header.author_len + rec_header.version_len;
+    }
+
+    header.data_crc = crc;
+
+    if (ok) {
+        rewind(fp);
+        ok = fwrite(&header, sizeof(header), 1, fp) == 1 && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    }
+
+    if (fclose(fp) != 0)
+        ok = false;
+
+    if (!ok) {
+        remove(APPS_INDEX_TMP_PATH);
+        return LV_RES_INV;
+    }
+
+    // The old index has to go first since renaming over an existing file fails on the SD card
+    remove(APPS_INDEX_PATH);
+    if (rename(APPS_INDEX_TMP_PATH, APPS_INDEX_PATH) != 0)
+        return LV_RES_INV;
+
+    g_dirty = false;
+
+    return LV_RES_OK;
+}
+
+void apps_index_set_scanned() {
+    mtx_lock(&g_index_mtx);
+    g_scanned = true;
+    mtx_unlock(&g_index_mtx);
+}
+
+lv_res_t apps_index_save() {
+    mtx_lock(&g_index_mtx);
+    lv_res_t res = index_save();
+    mtx_unlock(&g_index_mtx);
+
+    return res;
+}
+
+void apps_index_exit() {
+    for (u32 i = 0; i < g_recs_len; i++)
+        lv_mem_free(g_recs[i].strs);
+
+    lv_mem_free(g_recs);
+    lv_mem_free(g_slots);
+    lv_mem_free(g_dir_slots);
+    lv_mem_free(g_data);
+
+    g_recs = NULL;
+    g_recs_len = 0;
+    g_recs_cap = 0;
+
+    g_slots = NULL;
+    g_dir_slots = NULL;
+    g_slots_len = 0;
+
+    g_data = NULL;
+
+    g_loaded = false;
+    g_dirty = false;
+    g_scanned = false;
+}
+
+bool apps_index_lookup(app_entry_t *entry, app_info_t *info, u64 size, s64 mtime) {
+    mtx_lock(&g_index_mtx);
+
+    index_rec_t *rec = get_rec(entry->path);
+    if (rec == NULL || rec->size != size || rec->mtime != mtime || rec->type != entry->type) {
+        mtx_unlock(&g_index_mtx);
+        return false;
+    }
+
+    rec->seen = true;
+
+    strncpy(info->name, rec->name, APP_NAME_LEN - 1);
+    info->name[APP_NAME_LEN - 1] = '\0';
+    entry->name = info->name;
+
+    strncpy(info->author, rec->author, APP_AUTHOR_LEN - 1);
+    info->author[APP_AUTHOR_LEN - 1] = '\0';
+    entry->author = info->author;
+
+    strncpy(info->version, rec->version, APP_VER_LEN - 1);
+    info->version[APP_VER_LEN - 1] = '\0';
+    entry->version = info->version;
+
+    entry->icon_loc.offset = rec->icon_offset;
+    entry->icon_loc.size = rec->icon_size;
+    entry->icon_loc.stored_size = rec->icon_stored_size;
+    entry->icon_loc.method = rec->icon_method;
+    entry->icon_loc.thumb_slot = rec->thumb_slot;
+
+    mtx_unlock(&g_index_mtx);
+
+    return true;
+}
+
+void apps_index_update(app_entry_t *entry, u64 size, s64 mtime) {
+    size_t path_len = strlen(entry->path) + 1;
+    size_t name_len = strlen(entry->name) + 1;
+    size_t author_len = strlen(entry->author) + 1;
+    size_t version_len = strlen(entry->version) + 1;
+
+    char *strs = lv_mem_alloc(path_len + name_len + author_len + version_len);
+    if (strs == NULL)
+        return;
+
+    mtx_lock(&g_index_mtx);
+
+    index_rec_t *rec = get_rec(entry->path);
+    if (rec == NULL) {
+        rec = add_rec();
+        if (rec == NULL) {
+            mtx_unlock(&g_index_mtx);
+            lv_mem_free(strs);
+            return;
+        }
+    } else {
+        lv_mem_free(rec->strs);
+
+        // The app changed, so its thumbnail is outdated
+        if (rec->thumb_slot != entry->icon_loc.thumb_slot)
+            thumbs_release(rec->thumb_slot);
+    }
+
+    rec->strs = strs;
+
+    rec->path = memcpy(strs, entry->path, path_len);
+    rec->name = memcpy(strs + path_len, entry->name, name_len);
+    rec->author = memcpy(strs + path_len + name_len, entry->author, author_len);
+    rec->version = memcpy(strs + path_len + name_len + author_len, entry->version, version_len);
+
+    rec->size = size;
+    rec->mtime = mtime;
+    rec->icon_offset = entry->icon_loc.offset;
+    rec->icon_size = entry->icon_loc.size;
+    rec->icon_stored_size = entry->icon_loc.stored_size;
+    rec->icon_method = entry->icon_loc.method;
+    rec->thumb_slot = entry->icon_loc.thumb_slot;
+    rec->type = entry->type;
+    rec->seen = true;
+
+    set_slots(rec - g_recs);
+
+    g_dirty = true;
+
+    mtx_unlock(&g_index_mtx);
+}
+
+bool apps_index_resolve_dir(char *dir_path, char *out_path) {
+    mtx_lock(&g_index_mtx);
+
+    bool found = false;
+
+    if (g_slots_len != 0) {
+        s32 idx = *find_dir_slot(dir_path, strlen(dir_path));
+
+        if (idx >= 0) {
+            strncpy(out_path, g_recs[idx].path, PATH_MAX);
+            out_path[PATH_MAX] = '\0';
+            found = true;
+        }
+    }
+
+    mtx_unlock(&g_index_mtx);
+
+    return found;
+}
+
+bool apps_index_set_thumb(char *path, s32 slot) {
+    mtx_lock(&g_index_mtx);
+
+    index_rec_t *rec = get_rec(path);
+    if (rec == NULL) {
+        // Nothing would own the slot, so it would never be reused
+        thumbs_release(slot);
+    } else if (rec->thumb_slot != slot) {
+        thumbs_release(rec->thumb_slot);
+        rec->thumb_slot = slot;
+        g_dirty = true;
+    }
+
+    mtx_unlock(&g_index_mtx);
+
+    return rec != NULL;
+}
\ No newline at end of file
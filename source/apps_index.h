@@ -0,0 +1,31 @@
+#pragma once
+
+#include <lvgl/lvgl.h>
+#include <switch.h>
+
+#include "apps.h"
+#include "settings.h"
+
+#define APPS_INDEX_PATH SETTINGS_DIR "/apps.idx"
+
+// Has to be called before any of the other functions
+lv_res_t apps_index_load();
+lv_res_t apps_index_save();
+// Called once a scan has gone through every app, so the records of apps it didn't see are dropped on save
+void apps_index_set_scanned();
+void apps_index_exit();
+
+/*
+ * Fills in the info of the entry if the index has a record
+ * for its path with a matching size and modification time.
+ * The strings of the entry are pointed into the passed info.
+ */
+bool apps_index_lookup(app_entry_t *entry, app_info_t *info, u64 size, s64 mtime);
+void apps_index_update(app_entry_t *entry, u64 size, s64 mtime);
+
+// Records where the app's thumbnail was stored, releasing the slot it had before.
+// Returns false, with the new slot released, if the app isn't in the index.
+bool apps_index_set_thumb(char *path, s32 slot);
+
+// Gives the path of the app last found in the directory, if there is one
+bool apps_index_resolve_dir(char *dir_path, char *out_path);
\ No newline at end of file
@@ -1,79 +1,153 @@
+#include <stdlib.h>
+#include <threads.h>
 #include <lvgl/lvgl.h>
 #include <turbojpeg.h>
 #include <switch.h>
 
 #include "decoder.h"
+#include "downscale.h"
+#include "settings.h"
+#include "log.h"
+
+typedef struct {
+    const lv_img_dsc_t *src;
+    const u8 *data; // What src pointed to when it was decoded, in case the descriptor gets reused
+
+    u8 *img_data;
+    u32 size;
+    u32 refs; // How many open decoder descriptors use it, it can't be evicted while in use
+
+    bool stale; // Invalidated while in use, freed once the last user closes it
+} icon_cache_entry_t;
 
 static lv_img_decoder_t *g_jpg_dec;
 
-static int pos_from_coord(int x, int y, int w) {
-    return (y * w + x) * sizeof(lv_color_t);
+static tss_t g_decomp_key; // Each thread that decodes gets its own decompressor
+
+static lv_ll_t g_icon_cache; // Most recently used first
+static u32 g_icon_cache_size = 0;
+static u32 g_icon_cache_hits = 0;
+static u32 g_icon_cache_misses = 0;
+
+static void icon_cache_free(icon_cache_entry_t *entry) {
+    g_icon_cache_size -= entry->size;
+
+    lv_mem_free(entry->img_data);
+    lv_ll_rem(&g_icon_cache, entry);
+    lv_mem_free(entry);
 }
 
-static void downscale_img(u8 *src, u8 *dst, u32 src_w, u32 src_h, u32 dst_w, u32 dst_h) {
-    if (src_w == dst_w && src_h == dst_h) {
-        memcpy(dst, src, src_w * src_h * sizeof(lv_color_t));
-        return;
+static icon_cache_entry_t *icon_cache_find(const lv_img_dsc_t *src) {
+    icon_cache_entry_t *entry;
+
+    LV_LL_READ(g_icon_cache, entry) {
+        if (entry->src == src && entry->data == src->data && !entry->stale)
+            return entry;
     }
 
-    float x_scale = (float) src_w / (float) dst_w;
-    float y_scale = (float) src_h / (float) dst_h;
-
-    u8 b[4];
-    u8 g[4];
-    u8 r[4];
-    u8 a[4];
-    float f[4];
-    int w[4];
-
-    for (int x = 0; x < dst_w; x++) {
-        for (int y = 0; y < dst_h; y++) {
-            float src_x = x * x_scale;
-            float src_y = y * y_scale;
-            int pixel_x = src_x;
-            int pixel_y = src_y;
-
-            int pos = pos_from_coord(pixel_x, pixel_y, src_w);
-            b[0] = src[pos];
-            g[0] = src[pos + 1];
-            r[0] = src[pos + 2];
-            a[0] = src[pos + 3];
-
-            pos = pos_from_coord(pixel_x + 1, pixel_y, src_w);
-            b[1] = src[pos];
-            g[1] = src[pos + 1];
-            r[1] = src[pos + 2];
-            a[1] = src[pos + 3];
-
-            pos = pos_from_coord(pixel_x, pixel_y + 1, src_w);
-            b[2] = src[pos];
-            g[2] = src[pos + 1];
-            r[2] = src[pos + 2];
-            a[2] = src[pos + 3];
-
-            pos = pos_from_coord(pixel_x + 1, pixel_y + 1, src_w);
-            b[3] = src[pos];
-            g[3] = src[pos + 1];
-            r[3] = src[pos + 2];
-            a[3] = src[pos + 3];
-
-            f[0] = src_x - pixel_x;
-            f[1] = src_y - pixel_y;
-            f[2] = 1.0f - f[0];
-            f[3] = 1.0f - f[1];
-
-            w[0] = f[2] * f[3] * 256.0;
-            w[1] = f[0] * f[3] * 256.0;
-            w[2] = f[2] * f[1] * 256.0;
-            w[3] = f[0] * f[1] * 256.0;
-
-            pos = pos_from_coord(x, y, dst_w);
-            dst[pos] = (b[0] * w[0] + b[1] * w[1] + b[2] * w[2] + b[3] * w[3]) >> 8;
-            dst[pos + 1] = (g[0] * w[0] + g[1] * w[1] + g[2] * w[2] + g[3] * w[3]) >> 8;
-            dst[pos + 2] = (r[0] * w[0] + r[1] * w[1] + r[2] * w[2] + r[3] * w[3]) >> 8;
-            dst[pos + 3] = (a[0] * w[0] + a[1] * w[1] + a[2] * w[2] + a[3] * w[3]) >> 8;
-        }
+    return NULL;
+}
+
+static void icon_cache_evict(u32 needed) {
+    icon_cache_entry_t *entry = lv_ll_get_tail(&g_icon_cache);
+
+    while (entry != NULL && g_icon_cache_size + needed > curr_settings()->icon_cache_budget) {
+        icon_cache_entry_t *prev = lv_ll_get_prev(&g_icon_cache, entry);
+
+        if (entry->refs == 0)
+            icon_cache_free(entry);
+
+        entry = prev;
+    }
+}
+
+static icon_cache_entry_t *icon_cache_add(const lv_img_dsc_t *src, u8 *img_data, u32 size) {
+    icon_cache_evict(size);
+
+    icon_cache_entry_t *entry = lv_ll_ins_head(&g_icon_cache);
+    if (entry == NULL)
+        return NULL;
+
+    entry->src = src;
+    entry->data = src->data;
+    entry->img_data = img_data;
+    entry->size = size;
+    entry->refs = 0;
+    entry->stale = false;
+
+    g_icon_cache_size += size;
+
+    return entry;
+}
+
+static tjhandle get_decompressor() {
+    tjhandle decomp = tss_get(g_decomp_key);
+
+    if (decomp == NULL) {
+        decomp = tjInitDecompress();
+        if (decomp != NULL)
+            tss_set(g_decomp_key, decomp);
+    }
+
+    return decomp;
+}
+
+// Picks the smallest scale the DCT can decode at that's still at least as big as the target
+static tjscalingfactor pick_scaling_factor(int w, int h, int target_w, int target_h) {
+    tjscalingfactor best = {1, 1};
+
+    int num_factors;
+    tjscalingfactor *factors = tjGetScalingFactors(&num_factors);
+    if (factors == NULL)
+        return best;
+
+    for (int i = 0; i < num_factors; i++) {
+        int scaled_w = TJSCALED(w, factors[i]);
+        int scaled_h = TJSCALED(h, factors[i]);
+
+        if (scaled_w < target_w || scaled_h < target_h)
+            continue;
+
+        if (scaled_w * scaled_h < TJSCALED(w, best) * TJSCALED(h, best))
+            best = factors[i];
+    }
+
+    return best;
+}
+
+// Decodes to the size of the descriptor, into a buffer big enough for that many lv_color_t
+static lv_res_t jpg_decode(const lv_img_dsc_t *img_dsc, u8 *out) {
+    tjhandle decomp = get_decompressor();
+    if (decomp == NULL)
+        return LV_RES_INV;
+
+    int w, h, samp, color_space;
+
+    if (tjDecompressHeader3(decomp, img_dsc->data, img_dsc->data_size, &w, &h, &samp, &color_space))
+        return LV_RES_INV;
+
+    if (img_dsc->header.w > w || img_dsc->header.h > h)
+        return LV_RES_INV;
+
+    tjscalingfactor factor = pick_scaling_factor(w, h, img_dsc->header.w, img_dsc->header.h);
+    w = TJSCALED(w, factor);
+    h = TJSCALED(h, factor);
+
+    u8 *img_data = malloc(w * h * sizeof(lv_color_t));
+    if (img_data == NULL)
+        return LV_RES_INV;
+
+    // The scaling factor is picked from the passed size
+    if (tjDecompress2(decomp, img_dsc->data, img_dsc->data_size, img_data, w, 0, h, TJPF_BGRA, TJFLAG_ACCURATEDCT)) {
+        free(img_data);
+        return LV_RES_INV;
     }
+
+    lv_res_t res = downscale_img(img_data, out, w, h, img_dsc->header.w, img_dsc->header.h) ? LV_RES_OK : LV_RES_INV;
+
+    free(img_data);
+
+    return res;
 }
 
 static lv_res_t jpg_dec_info(lv_img_decoder_t *dec, const void *src, lv_img_header_t *header) {
@@ -83,14 +157,24 @@ static lv_res_t jpg_dec_info(lv_img_decoder_t *dec, const void *src, lv_img_head
 
     const lv_img_dsc_t *dsc = src;
 
+    // Already decoded images are left to LVGL
+    if (dsc->header.cf != LV_IMG_CF_RAW)
+        return LV_RES_INV;
+
     header->always_zero = 0;
     header->w = dsc->header.w;
     header->h = dsc->header.h;
-    header->cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
+    header->cf = LV_IMG_CF_TRUE_COLOR; // JPEGs are opaque, so they're drawn without blending
 
     return LV_RES_OK;
 }
 
+/*
+ * Images are decoded whole when they're opened, there's no read_line_cb. The
+ * only JPEG big enough for streaming to save much is the theme background,
+ * and it's drawn again behind every cursor move. libjpeg can only read
+ * forward, so each of those redraws would decode it from its first line again.
+ */
 static lv_res_t jpg_dec_open(lv_img_decoder_t *dec, lv_img_decoder_dsc_t *dsc) {
     // Let's not deal with it if it's not an image descriptor
     if (dsc->src_type != LV_IMG_SRC_VARIABLE)
@@ -98,46 +182,112 @@ static lv_res_t jpg_dec_open(lv_img_decoder_t *dec, lv_img_decoder_dsc_t *dsc) {
 
     const lv_img_dsc_t *img_dsc = dsc->src;
 
-    tjhandle decomp = tjInitDecompress();
-    if (decomp == NULL)
-        return LV_RES_INV;
+    icon_cache_entry_t *cached = icon_cache_find(img_dsc);
+    if (cached != NULL) {
+        g_icon_cache_hits++;
 
-    int w, h, samp, color_space;
+        lv_ll_move_before(&g_icon_cache, cached, lv_ll_get_head(&g_icon_cache));
 
-    if (tjDecompressHeader3(decomp, img_dsc->data, img_dsc->data_size, &w, &h, &samp, &color_space)) {
-        tjDestroy(decomp);
-        return LV_RES_INV;
-    }
+        cached->refs++;
+        dsc->img_data = cached->img_data;
+        dsc->user_data = cached;
 
-    if (img_dsc->header.w > w || img_dsc->header.h > h) {
-        tjDestroy(decomp);
-        return LV_RES_INV;
+        return LV_RES_OK;
     }
 
-    u8 *img_data = lv_mem_alloc(w * h * sizeof(lv_color_t));
+    u32 resized_size = img_dsc->header.w * img_dsc->header.h * sizeof(lv_color_t);
 
-    if (tjDecompress2(decomp, img_dsc->data, img_dsc->data_size, img_data, w, 0, h, TJPF_BGRA, TJFLAG_ACCURATEDCT)) {
-        tjFree(img_data);
-        tjDestroy(decomp);
+    u8 *resized_data = lv_mem_alloc(resized_size);
+    if (resized_data == NULL)
         return LV_RES_INV;
-    }
 
-    u8 *resized_data = lv_mem_alloc(img_dsc->header.w * img_dsc->header.h * sizeof(lv_color_t));
-    downscale_img(img_data, resized_data, w, h, img_dsc->header.w, img_dsc->header.h);
+    if (jpg_decode(img_dsc, resized_data) != LV_RES_OK) {
+        lv_mem_free(resized_data);
+        return LV_RES_INV;
+    }
 
     dsc->img_data = resized_data;
 
-    lv_mem_free(img_data);
-    tjDestroy(decomp);
+    g_icon_cache_misses++;
+
+    // If it can't be cached, it's freed on close like before
+    cached = icon_cache_add(img_dsc, resized_data, resized_size);
+    if (cached != NULL)
+        cached->refs++;
+
+    dsc->user_data = cached;
+
     return LV_RES_OK;
 }
 
 static void jpg_dec_close(lv_img_decoder_t *dec, lv_img_decoder_dsc_t *dsc) {
-    lv_mem_free(dsc->img_data);
+    icon_cache_entry_t *cached = dsc->user_data;
+
+    if (cached == NULL) {
+        lv_mem_free((void *) dsc->img_data);
+        return;
+    }
+
+    cached->refs--;
+
+    if (cached->stale && cached->refs == 0)
+        icon_cache_free(cached);
+    else
+        icon_cache_evict(0);
+}
+
+void decoderInvalidate(const lv_img_dsc_t *src) {
+    // Makes LVGL close it first if it has it open
+    lv_img_cache_invalidate_src(src);
+
+    icon_cache_entry_t *entry = lv_ll_get_head(&g_icon_cache);
+
+    while (entry != NULL) {
+        icon_cache_entry_t *next = lv_ll_get_next(&g_icon_cache, entry);
+
+        if (entry->src == src) {
+            if (entry->refs == 0)
+                icon_cache_free(entry);
+            else
+                entry->stale = true;
+        }
+
+        entry = next;
+    }
 }
 
 
+lv_res_t decoderDecode(const lv_img_dsc_t *src, void *out) {
+    return jpg_decode(src, out);
+}
+
+lv_res_t decoderDecodeJpeg(const void *data, u32 data_size, void *out, u32 out_size) {
+    tjhandle decomp = get_decompressor();
+    if (decomp == NULL)
+        return LV_RES_INV;
+
+    int w, h, samp, color_space;
+    if (tjDecompressHeader3(decomp, data, data_size, &w, &h, &samp, &color_space))
+        return LV_RES_INV;
+
+    if (w * h * sizeof(lv_color_t) != out_size)
+        return LV_RES_INV;
+
+    if (tjDecompress2(decomp, data, data_size, out, w, 0, h, TJPF_BGRA, TJFLAG_ACCURATEDCT))
+        return LV_RES_INV;
+
+    return LV_RES_OK;
+}
+
+void decoderExit() {
+    logPrintf("icon cache: %u hits, %u misses, %u bytes\n", g_icon_cache_hits, g_icon_cache_misses, g_icon_cache_size);
+}
+
 void decoderInitialize() {
+    lv_ll_init(&g_icon_cache, sizeof(icon_cache_entry_t));
+
+    tss_create(&g_decomp_key, (tss_dtor_t) tjDestroy);
+
     g_jpg_dec = lv_img_decoder_create();
     lv_img_decoder_set_info_cb(g_jpg_dec, jpg_dec_info);
     lv_img_decoder_set_open_cb(g_jpg_dec, jpg_dec_open);
@@ -2,4 +2,14 @@
 
 #include <lvgl/lvgl.h>
 
-void decoderInitialize();
\ No newline at end of file
+void decoderInitialize();
+// Logs how well the icon cache did
+void decoderExit();
+
+// Decodes a JPEG descriptor to its size, the output has room for that many lv_color_t
+lv_res_t decoderDecode(const lv_img_dsc_t *src, void *out);
+// Decodes JPEG data at its own size to BGRA, fails if that doesn't come out to out_size bytes
+lv_res_t decoderDecodeJpeg(const void *data, u32 data_size, void *out, u32 out_size);
+
+// Drops the decoded image of a source whose data is about to be freed
+void decoderInvalidate(const lv_img_dsc_t *src);
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include <stdlib.h>
+#include <string.h>
+
+// DOWNSCALE_SCALAR leaves out the SIMD kernels, so they can be compared with the scalar ones
+#ifndef DOWNSCALE_SCALAR
+
+#if defined(__ARM_NEON)
+
+#include <arm_neon.h>
+#define DOWNSCALE_NEON
+
+#elif defined(__SSE2__)
+
+#include <emmintrin.h>
+#define DOWNSCALE_SSE2
+
+#endif
+
+#endif
+
+#include "downscale.h"
+
+#define PX_SIZE 4
+
+#define BOX_WEIGHT_BITS 14
+
+// The source pixels that are averaged into one destination pixel, along one axis
+typedef struct {
+    uint16_t start;
+    uint16_t count;
+    uint16_t *weights; // Sum up to 1 << BOX_WEIGHT_BITS
+} box_span_t;
+
+/*
+ * Each destination pixel covers src_len / dst_len source pixels,
+ * which are weighted by how much of them it covers. Only source
+ * pixels that are in the image get a span, so edges never read past it.
+ */
+static void box_spans_init(box_span_t *spans, uint16_t *weights, uint32_t max_taps, uint32_t src_len, uint32_t dst_len) {
+    for (uint32_t d = 0; d < dst_len; d++) {
+        // In units of 1 / dst_len source pixels
+        uint32_t lo = d * src_len;
+        uint32_t hi = lo + src_len;
+
+        box_span_t *span = &spans[d];
+        span->start = lo / dst_len;
+        span->count = (hi + dst_len - 1) / dst_len - span->start;
+        span->weights = &weights[d * max_taps];
+
+        uint32_t total = 0;
+
+        for (uint32_t i = 0; i < span->count; i++) {
+            uint32_t px_lo = (span->start + i) * dst_len;
+            uint32_t px_hi = px_lo + dst_len;
+
+            if (px_lo < lo)
+                px_lo = lo;
+            if (px_hi > hi)
+                px_hi = hi;
+
+            span->weights[i] = ((px_hi - px_lo) << BOX_WEIGHT_BITS) / src_len;
+            total += span->weights[i];
+        }
+
+        // Whatever got rounded away goes to the last pixel so the weights always add up
+        span->weights[span->count - 1] += (1 << BOX_WEIGHT_BITS) - total;
+    }
+}
+
+#ifdef DOWNSCALE_SSE2
+
+// Multiplies 8 unsigned 16 bit lanes by a weight, giving the 32 bit products of the low and high 4
+static inline void sse2_mul_u16(__m128i values, __m128i weight, __m128i *lo, __m128i *hi) {
+    __m128i prod_lo = _mm_mullo_epi16(values, weight);
+    __m128i prod_hi = _mm_mulhi_epu16(values, weight);
+
+    *lo = _mm_unpacklo_epi16(prod_lo, prod_hi);
+    *hi = _mm_unpackhi_epi16(prod_lo, prod_hi);
+}
+
+#endif
+
+// Adds a weighted source row to the vertical sums, a plain multiply-add over bytes
+static void box_accumulate_row(uint32_t *acc, const uint8_t *src_row, uint16_t weight, uint32_t len) {
+    uint32_t i = 0;
+
+    #if defined(DOWNSCALE_NEON)
+
+    for (; i + 8 <= len; i += 8) {
+        uint16x8_t values = vmovl_u8(vld1_u8(&src_row[i]));
+
+        vst1q_u32(&acc[i], vmlal_n_u16(vld1q_u32(&acc[i]), vget_low_u16(values), weight));
+        vst1q_u32(&acc[i + 4], vmlal_n_u16(vld1q_u32(&acc[i + 4]), vget_high_u16(values), weight));
+    }
+
+    #elif defined(DOWNSCALE_SSE2)
+
+    __m128i weights = _mm_set1_epi16(weight);
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *) &src_row[i]);
+        __m128i prod[4];
+
+        sse2_mul_u16(_mm_unpacklo_epi8(bytes, _mm_setzero_si128()), weights, &prod[0], &prod[1]);
+        sse2_mul_u16(_mm_unpackhi_epi8(bytes, _mm_setzero_si128()), weights, &prod[2], &prod[3]);
+
+        for (int j = 0; j < 4; j++) {
+            __m128i *dst = (__m128i *) &acc[i + j * 4];
+            _mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst), prod[j]));
+        }
+    }
+
+    #endif
+
+    for (; i < len; i++)
+        acc[i] += src_row[i] * weight;
+}
+
+// Drops the vertical sums to 16 bits, keeping 8 extra bits of precision
+static void box_narrow_row(const uint32_t *acc, uint16_t *row, uint32_t len) {
+    uint32_t i = 0;
+
+    #if defined(DOWNSCALE_NEON)
+
+    for (; i + 4 <= len; i += 4)
+        vst1_u16(&row[i], vshrn_n_u32(vld1q_u32(&acc[i]), BOX_WEIGHT_BITS - 8));
+
+    #elif defined(DOWNSCALE_SSE2)
+
+    // The results fit in 16 bits, they're offset so the signed pack doesn't saturate them
+    __m128i offset = _mm_set1_epi32(0x8000);
+
+    for (; i + 8 <= len; i += 8) {
+        __m128i lo = _mm_sub_epi32(_mm_srli_epi32(_mm_loadu_si128((const __m128i *) &acc[i]), BOX_WEIGHT_BITS - 8), offset);
+        __m128i hi = _mm_sub_epi32(_mm_srli_epi32(_mm_loadu_si128((const __m128i *) &acc[i + 4]), BOX_WEIGHT_BITS - 8), offset);
+
+        _mm_storeu_si128((__m128i *) &row[i], _mm_add_epi16(_mm_packs_epi32(lo, hi), _mm_set1_epi16(-0x8000)));
+    }
+
+    #endif
+
+    for (; i < len; i++)
+        row[i] = acc[i] >> (BOX_WEIGHT_BITS - 8);
+}
+
+// Averages the vertically filtered row horizontally, one destination pixel at a time
+static void box_filter_row(const uint16_t *row, uint32_t *out, const box_span_t *spans, uint32_t dst_w) {
+    for (uint32_t x = 0; x < dst_w; x++) {
+        const box_span_t *span = &spans[x];
+        const uint16_t *px = row + span->start * PX_SIZE;
+
+        #if defined(DOWNSCALE_NEON)
+
+        uint32x4_t sum = vdupq_n_u32(0);
+
+        for (uint32_t i = 0; i < span->count; i++, px += PX_SIZE)
+            sum = vmlal_n_u16(sum, vld1_u16(px), span->weights[i]);
+
+        vst1q_u32(&out[x * 4], sum);
+
+        #elif defined(DOWNSCALE_SSE2)
+
+        __m128i sum = _mm_setzero_si128();
+
+        for (uint32_t i = 0; i < span->count; i++, px += PX_SIZE) {
+            __m128i prod, unused;
+            sse2_mul_u16(_mm_loadl_epi64((const __m128i *) px), _mm_set1_epi16(span->weights[i]), &prod, &unused);
+
+            sum = _mm_add_epi32(sum, prod);
+        }
+
+        _mm_storeu_si128((__m128i *) &out[x * 4], sum);
+
+        #else
+
+        uint32_t sum[4] = {0};
+
+        for (uint32_t i = 0; i < span->count; i++, px += PX_SIZE) {
+            for (int c = 0; c < 4; c++)
+                sum[c] += px[c] * span->weights[i];
+        }
+
+        memcpy(&out[x * 4], sum, sizeof(sum));
+
+        #endif
+    }
+}
+
+bool downscale_img(const uint8_t *src, uint8_t *dst, uint32_t src_w, uint32_t src_h, uint32_t dst_w, uint32_t dst_h) {
+    if (src_w == dst_w && src_h == dst_h) {
+        memcpy(dst, src, src_w * src_h * PX_SIZE);
+        return true;
+    }
+
+    uint32_t taps_x = (src_w + dst_w - 1) / dst_w + 1;
+    uint32_t taps_y = (src_h + dst_h - 1) / dst_h + 1;
+    uint32_t src_len = src_w * 4;
+    uint32_t dst_len = dst_w * 4;
+
+    size_t size = (dst_w + dst_h) * sizeof(box_span_t) + (src_len + dst_len) * sizeof(uint32_t) +
+                  (dst_w * taps_x + dst_h * taps_y + src_len) * sizeof(uint16_t);
+
+    uint8_t *scratch = malloc(size);
+    if (scratch == NULL)
+        return false;
+
+    box_span_t *spans_x = (box_span_t *) scratch;
+    box_span_t *spans_y = spans_x + dst_w;
+    uint32_t *acc = (uint32_t *) (spans_y + dst_h);
+    uint32_t *out = acc + src_len;
+    uint16_t *row = (uint16_t *) (out + dst_len);
+    uint16_t *weights_x = row + src_len;
+    uint16_t *weights_y = weights_x + dst_w * taps_x;
+
+    box_spans_init(spans_x, weights_x, taps_x, src_w, dst_w);
+    box_spans_init(spans_y, weights_y, taps_y, src_h, dst_h);
+
+    /*
+     * The vertical pass goes first, since it's a contiguous multiply-add over
+     * whole source rows. The horizontal pass with its per pixel spans then
+     * only runs once per destination row.
+     */
+    for (uint32_t y = 0; y < dst_h; y++) {
+        box_span_t *span = &spans_y[y];
+
+        memset(acc, 0, src_len * sizeof(uint32_t));
+
+        for (uint32_t i = 0; i < span->count; i++)
+            box_accumulate_row(acc, src + (span->start + i) * src_len, span->weights[i], src_len);
+
+        box_narrow_row(acc, row, src_len);
+        box_filter_row(row, out, spans_x, dst_w);
+
+        uint8_t *dst_row = dst + y * dst_len;
+        for (uint32_t i = 0; i < dst_len; i++)
+            dst_row[i] = (out[i] + (1 << (BOX_WEIGHT_BITS + 8 - 1))) >> (BOX_WEIGHT_BITS + 8);
+
+        // The alpha byte of lv_color_t
+        for (uint32_t x = 0; x < dst_w; x++)
+            dst_row[x * PX_SIZE + 3] = 0xFF;
+    }
+
+    free(scratch);
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Area averaging downscale of 32 bit pixels, going through the source row by
+ * row. The output is opaque. This doesn't depend on libnx or LVGL, so it can
+ * be benchmarked on the host. Returns false if the scratch memory can't be had.
+ */
+bool downscale_img(const uint8_t *src, uint8_t *dst, uint32_t src_w, uint32_t src_h, uint32_t dst_w, uint32_t dst_h);
\ No newline at end of file
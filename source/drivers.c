@@ -205,6 +205,9 @@ void driversInitialize() {
     lv_indev_set_group(g_keypad_indev, g_keypad_group);
 
     if (curr_settings()->use_gyro) {
+        // Kept loaded for as long as the cursor is drawn
+        theme_acquire(&curr_theme()->cursor_dsc);
+
         lv_indev_drv_t pointer_drv;
         lv_indev_drv_init(&pointer_drv);
         pointer_drv.type = LV_INDEV_TYPE_POINTER;
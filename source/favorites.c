@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <threads.h>
+#include <lvgl/lvgl.h>
+#include <switch.h>
+
+#include "favorites.h"
+#include "log.h"
+#include "util.h"
+
+#define FAVORITES_TMP_PATH FAVORITES_PATH ".tmp"
+
+static char **g_slots = NULL; // Open addressed table of owned paths
+static u32 g_slots_len = 0;
+static u32 g_slots_used = 0; // Includes removed slots, which still have to be probed past
+
+static char g_removed[1]; // Marks a slot whose path was removed
+
+static bool g_loaded = false;
+static bool g_importing = false;
+static bool g_dirty = false;
+
+// Lookups are done from the scan threads while the UI thread stars apps
+static mtx_t g_favorites_mtx;
+static bool g_mtx_init = false;
+
+static char **find_slot(const char *path) {
+    u32 mask = g_slots_len - 1;
+    char **free_slot = NULL;
+
+    for (u32 i = hash_str(path) & mask; ; i = (i + 1) & mask) {
+        if (g_slots[i] == NULL)
+            return (free_slot != NULL) ? free_slot : &g_slots[i];
+
+        if (g_slots[i] == g_removed) {
+            if (free_slot == NULL)
+                free_slot = &g_slots[i];
+        } else if (strcmp(g_slots[i], path) == 0) {
+            return &g_slots[i];
+        }
+    }
+}
+
+static lv_res_t grow_slots() {
+    if (g_slots_len != 0 && (g_slots_used + 1) * 2 <= g_slots_len)
+        return LV_RES_OK;
+
+    u32 new_len = (g_slots_len == 0) ? 64 : g_slots_len * 2;
+
+    char **new_slots = lv_mem_alloc(new_len * sizeof(char *));
+    if (new_slots == NULL)
+        return LV_RES_INV;
+
+    memset(new_slots, 0, new_len * sizeof(char *));
+
+    char **old_slots = g_slots;
+    u32 old_len = g_slots_len;
+
+    g_slots = new_slots;
+    g_slots_len = new_len;
+    g_slots_used = 0;
+
+    for (u32 i = 0; i < old_len; i++) {
+        if (old_slots[i] == NULL || old_slots[i] == g_removed)
+            continue;
+
+        *find_slot(old_slots[i]) = old_slots[i];
+        g_slots_used++;
+    }
+
+    lv_mem_free(old_slots);
+
+    return LV_RES_OK;
+}
+
+static bool has_path(const char *path) {
+    if (g_slots_len == 0)
+        return false;
+
+    char *slot = *find_slot(path);
+    return slot != NULL && slot != g_removed;
+}
+
+static lv_res_t add_path(const char *path) {
+    if (grow_slots() != LV_RES_OK)
+        return LV_RES_INV;
+
+    char **slot = find_slot(path);
+    if (*slot != NULL && *slot != g_removed)
+        return LV_RES_OK;
+
+    size_t size = strlen(path) + 1;
+
+    char *dup = lv_mem_alloc(size);
+    if (dup == NULL)
+        return LV_RES_INV;
+
+    memcpy(dup, path, size);
+
+    if (*slot == NULL)
+        g_slots_used++;
+
+    *slot = dup;
+
+    return LV_RES_OK;
+}
+
+lv_res_t favorites_load() {
+    if (!g_mtx_init) {
+        mtx_init(&g_favorites_mtx, mtx_plain);
+        g_mtx_init = true;
+    }
+
+    if (g_loaded)
+        return LV_RES_OK;
+
+    g_loaded = true;
+
+    FILE *fp = fopen(FAVORITES_PATH, "r");
+    if (fp == NULL) {
+        g_importing = true;
+        return LV_RES_OK;
+    }
+
+    char line[PATH_MAX + 2];
+    u32 count = 0;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if (line[0] == '\0')
+            continue;
+
+        if (add_path(line) != LV_RES_OK) {
+            LV_LOG_WARN("Couldn't add favorite");
+            break;
+        }
+
+        count++;
+    }
+
+    fclose(fp);
+
+    logPrintf("favorites: %u apps\n", count);
+
+    return LV_RES_OK;
+}
+
+static lv_res_t save() {
+    if (!g_dirty && !g_importing)
+        return LV_RES_OK;
+
+    FILE *fp = fopen(FAVORITES_TMP_PATH, "w");
+    if (fp == NULL)
+        return LV_RES_INV;
+
+    bool ok = true;
+
+    for (u32 i = 0; i < g_slots_len && ok; i++) {
+        if (g_slots[i] == NULL || g_slots[i] == g_removed)
+            continue;
+
+        ok = fprintf(fp, "%s\n", g_slots[i]) >= 0;
+    }
+
+    if (ok)
+        ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+
+    if (fclose(fp) != 0)
+        ok = false;
+
+    if (!ok) {
+        remove(FAVORITES_TMP_PATH);
+        return LV_RES_INV;
+    }
+
+    // The old file has to go first since renaming over an existing file fails on the SD card
+    remove(FAVORITES_PATH);
+    if (rename(FAVORITES_TMP_PATH, FAVORITES_PATH) != 0)
+        return LV_RES_INV;
+
+    g_importing = false;
+    g_dirty = false;
+
+    return LV_RES_OK;
+}
+
+lv_res_t favorites_save() {
+    mtx_lock(&g_favorites_mtx);
+    lv_res_t res = save();
+    mtx_unlock(&g_favorites_mtx);
+
+    return res;
+}
+
+void favorites_exit() {
+    for (u32 i = 0; i < g_slots_len; i++) {
+        if (g_slots[i] != g_removed)
+            lv_mem_free(g_slots[i]);
+    }
+
+    lv_mem_free(g_slots);
+
+    g_slots = NULL;
+    g_slots_len = 0;
+    g_slots_used = 0;
+
+    g_loaded = false;
+    g_importing = false;
+    g_dirty = false;
+}
+
+bool favorites_importing() {
+    mtx_lock(&g_favorites_mtx);
+    bool importing = g_importing;
+    mtx_unlock(&g_favorites_mtx);
+
+    return importing;
+}
+
+bool favorites_contains(const char *path) {
+    mtx_lock(&g_favorites_mtx);
+
+    bool found = has_path(path);
+    mtx_unlock(&g_favorites_mtx);
+
+    return found;
+}
+
+void favorites_set(const char *path, bool star) {
+    mtx_lock(&g_favorites_mtx);
+
+    if (star == has_path(path)) {
+        mtx_unlock(&g_favorites_mtx);
+        return;
+    }
+
+    if (star) {
+        if (add_path(path) == LV_RES_OK)
+            g_dirty = true;
+    } else {
+        char **slot = find_slot(path);
+        lv_mem_free(*slot);
+        *slot = g_removed;
+        g_dirty = true;
+    }
+
+    mtx_unlock(&g_favorites_mtx);
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <lvgl/lvgl.h>
+#include <switch.h>
+
+#include "settings.h"
+
+#define FAVORITES_PATH SETTINGS_DIR "/favorites.txt"
+
+// Has to be called before any of the other functions
+lv_res_t favorites_load();
+lv_res_t favorites_save();
+void favorites_exit();
+
+/*
+ * True until the favorites file has been written for the first time.
+ * While importing, stars are taken from the old .star files.
+ */
+bool favorites_importing();
+
+bool favorites_contains(const char *path);
+void favorites_set(const char *path, bool star);
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <threads.h>
 #include <lvgl/lvgl.h>
 
@@ -8,10 +10,15 @@
 #include "decoder.h"
 #include "drivers.h"
 #include "apps.h"
+#include "apps_index.h"
+#include "favorites.h"
+#include "icons.h"
+#include "icon_pool.h"
 #include "remote.h"
 #include "remote_net.h"
 #include "limitations.h"
 #include "status.h"
+#include "thumbs.h"
 #include "settings.h"
 #include "theme.h"
 #include "text.h"
@@ -28,8 +35,7 @@ enum {
     DialogButton_max
 };
 
-static lv_ll_t g_apps_ll;
-static int g_apps_ll_len;
+static app_catalog_t g_apps;
 
 static lv_obj_t *g_curr_focused_tmp = NULL;
 
@@ -42,6 +48,42 @@ static lv_obj_t *g_list_covers_tmp[MAX_LIST_ROWS] = {0};
 static app_entry_t *g_list_entries[MAX_LIST_ROWS] = {0};
 static app_entry_t *g_list_entries_tmp[MAX_LIST_ROWS] = {0};
 
+static lv_obj_t *g_list_icons[MAX_LIST_ROWS] = {0};
+static lv_obj_t *g_list_icons_tmp[MAX_LIST_ROWS] = {0};
+
+#define ATLAS_ROWS (MAX_LIST_ROWS * 2)
+
+/*
+ * The small icons of the rows are copied into one image, each row showing its part of
+ * it, so they all share one image cache entry. One half is for the rows that are shown,
+ * the other one for the rows that slide in when the page changes. The copy costs
+ * ATLAS_ROWS icons of static memory on top of the pooled icons.
+ */
+static lv_color_t g_atlas_data[ATLAS_ROWS * APP_ICON_SMALL_W * APP_ICON_SMALL_H] = {0};
+static const lv_img_dsc_t g_atlas = {
+    .header.always_zero = 0,
+    .header.w = APP_ICON_SMALL_W,
+    .header.h = APP_ICON_SMALL_H * ATLAS_ROWS,
+    .data_size = sizeof(g_atlas_data),
+    .header.cf = LV_IMG_CF_TRUE_COLOR, // Icons are opaque, so they're drawn without blending
+    .data = (const u8 *) g_atlas_data,
+};
+static int g_atlas_half = 0; // The half used by the shown rows
+
+static u32 g_icon_gen = 0; // Changes with the page, icons requested for older pages can be cancelled
+
+#define PREFETCH_MAX_PAGES 8
+
+// Entries whose icons were loaded ahead for the pages next to the shown one, and aren't shown themselves
+static app_entry_t *g_prefetched[PREFETCH_MAX_PAGES * MAX_LIST_ROWS] = {0};
+static int g_num_prefetched = 0;
+
+// How many pages after and before the shown one are prefetched
+static int g_prefetch_next = 1;
+static int g_prefetch_prev = 1;
+static int g_last_page_dir = 0;
+static bool g_prefetch_issued = false;
+
 static lv_obj_t *g_dialog_buttons[DialogButton_max] = {0};
 static lv_obj_t *g_dialog_cover = NULL;
 static app_entry_t *g_dialog_entry = NULL;
@@ -50,6 +92,8 @@ static int g_list_index = 0; // -3 for right arrow, -2 for left
 
 static lv_obj_t *g_arrow_buttons[2] = {0}; // {next, prev}
 
+static bool g_list_drawn = false;
+
 static int g_curr_page = 0;
 static lv_anim_t g_page_list_anims[MAX_LIST_ROWS] = {0};
 static lv_anim_t g_page_arrow_anims[2] = {0};
@@ -74,46 +118,127 @@ static const char *g_ok_btns[] = {NULL, ""};
 
 static void change_page(int dir);
 static void draw_buttons();
+static void update_buttons(s32 first_changed, int old_num_buttons);
 
 static void gen_apps_list() {
-    app_entry_ll_init(&g_apps_ll);
-    g_apps_ll_len = lv_ll_get_len(&g_apps_ll);
+    app_catalog_init(&g_apps);
 }
 
 static inline int num_buttons() {
-    return fmin(g_apps_ll_len - MAX_LIST_ROWS * g_curr_page, MAX_LIST_ROWS);
+    return fmin((int) g_apps.len - MAX_LIST_ROWS * g_curr_page, MAX_LIST_ROWS);
 }
 
 static inline bool on_last_page() {
-    return g_apps_ll_len - ((g_curr_page + 1) * MAX_LIST_ROWS) <= 0;
+    return (int) g_apps.len - ((g_curr_page + 1) * MAX_LIST_ROWS) <= 0;
+}
+
+static inline app_entry_t *get_app_for_button(int btn_idx) {
+    return app_catalog_get(&g_apps, g_curr_page * MAX_LIST_ROWS + btn_idx);
+}
+
+static inline int prefetch_max_pages() {
+    return fmin(curr_settings()->icon_prefetch_budget / (MAX_LIST_ROWS * THUMB_DATA_SIZE), PREFETCH_MAX_PAGES);
 }
 
-static app_entry_t *get_app_for_button(int btn_idx) {
-    app_entry_t *entry;
-    int i = 0;
+static bool in_prefetch_window(app_entry_t *entry) {
+    s32 idx = app_catalog_find(&g_apps, entry);
+    if (idx < 0)
+        return false;
 
-    btn_idx = g_curr_page * MAX_LIST_ROWS + btn_idx;
+    int page = idx / MAX_LIST_ROWS;
 
-    LV_LL_READ(g_apps_ll, entry) {
-        if (i == btn_idx)
-            return entry;
-        i++;
+    return page != g_curr_page && page >= g_curr_page - g_prefetch_prev && page <= g_curr_page + g_prefetch_next;
+}
+
+// Called when an entry gets shown, its icon is then owned by the row
+static void prefetch_take(app_entry_t *entry) {
+    for (int i = 0; i < g_num_prefetched; i++) {
+        if (g_prefetched[i] == entry) {
+            g_prefetched[i] = g_prefetched[--g_num_prefetched];
+            return;
+        }
     }
+}
 
-    return NULL;
+static bool entry_shown(app_entry_t *entry) {
+    for (int i = 0; i < MAX_LIST_ROWS; i++) {
+        if (g_list_entries[i] == entry || g_list_entries_tmp[i] == entry)
+            return true;
+    }
+
+    return false;
 }
 
-static void free_current_app_icons() {
-    for (int i = 0; i < num_buttons(); i++)
-        app_entry_free_icon(g_list_entries[i]);
+// Called when a row stops showing the entry, its icon is kept if it's likely to be shown again soon
+static void release_icon(app_entry_t *entry) {
+    // It might've only moved to another row
+    if (entry == NULL || !app_entry_has_icon(entry) || entry_shown(entry))
+        return;
+
+    if (g_num_prefetched < PREFETCH_MAX_PAGES * MAX_LIST_ROWS && in_prefetch_window(entry)) {
+        g_prefetched[g_num_prefetched++] = entry;
+        return;
+    }
+
+    app_entry_free_icon(entry);
 }
 
-static void del_buttons() {
-    for (int i = 0; i < num_buttons(); i++) {
+// Frees the prefetched icons that fell out of the window
+static void trim_prefetched() {
+    int kept = 0;
+
+    for (int i = 0; i < g_num_prefetched; i++) {
+        if (in_prefetch_window(g_prefetched[i]))
+            g_prefetched[kept++] = g_prefetched[i];
+        else
+            app_entry_free_icon(g_prefetched[i]);
+    }
+
+    g_num_prefetched = kept;
+    g_prefetch_issued = false;
+}
+
+/*
+ * Paging on in the same direction grows the window that way,
+ * at the cost of the other side once the budget is used up.
+ */
+static void move_prefetch_window(int dir) {
+    int max_pages = prefetch_max_pages();
+
+    int *ahead = (dir > 0) ? &g_prefetch_next : &g_prefetch_prev;
+    int *behind = (dir > 0) ? &g_prefetch_prev : &g_prefetch_next;
+
+    if (dir == g_last_page_dir) {
+        (*ahead)++;
+    } else {
+        *ahead = 1;
+        *behind = 1;
+    }
+
+    while (*ahead + *behind > max_pages && *behind > 0)
+        (*behind)--;
+
+    *ahead = fmin(*ahead, max_pages);
+
+    g_last_page_dir = dir;
+}
+
+static void free_app_icons(int count) {
+    for (int i = 0; i < count; i++) {
+        app_entry_t *entry = g_list_entries[i];
+        g_list_entries[i] = NULL;
+
+        release_icon(entry);
+    }
+}
+
+static void del_buttons(int count) {
+    for (int i = 0; i < count; i++) {
         lv_obj_del(g_list_buttons[i]);
 
         g_list_buttons[i] = NULL;
         g_list_covers[i] = NULL;
+        g_list_icons[i] = NULL;
     }
 
     for (int i = 0; i < 2; i++) {
@@ -125,39 +250,54 @@ static void del_buttons() {
     }
 }
 
-static void reset_menu_focused_on(char *path) {
-    del_buttons();
-    free_current_app_icons();
-
-    char entry_path[PATH_MAX + 1];
-    strncpy(entry_path, path, PATH_MAX);
-    entry_path[PATH_MAX] = '\0';
+/*
+ * Shows the page with the app at idx and focuses it after the catalog
+ * was changed from first_changed on. If the page stays the same, only
+ * the rows that changed are redrawn.
+ */
+static void reset_menu_focused_on(s32 idx, s32 first_changed, int old_num_buttons) {
+    if (idx / MAX_LIST_ROWS == g_curr_page && num_buttons() > 0) {
+        update_buttons(first_changed, old_num_buttons);
+    } else {
+        free_app_icons(old_num_buttons);
+        del_buttons(old_num_buttons);
+
+        g_curr_page = (idx < 0) ? 0 : idx / MAX_LIST_ROWS;
+
+        draw_buttons();
+        trim_prefetched();
+    }
 
-    lv_ll_clear(&g_apps_ll);
-    gen_apps_list();
+    if (idx >= 0 && num_buttons() > 0)
+        lv_group_focus_obj(g_list_buttons[idx % MAX_LIST_ROWS]);
+}
 
-    int i = 0;
-    app_entry_t *tmp_entry;
-    LV_LL_READ(g_apps_ll, tmp_entry) {
-        if (strcmp(entry_path, tmp_entry->path) == 0)
-            break;
+static void focus_cb(lv_group_t *group, lv_style_t *style) { }
 
-        i++;
-    }
+// The dialog images are loaded while a dialog is open
+static void dialog_acquire_images() {
+    theme_acquire(&curr_theme()->dialog_bg_dsc);
+    theme_acquire(&curr_theme()->star_dscs[1]);
 
-    g_curr_page = i / MAX_LIST_ROWS;
+    for (int i = 0; i < 2; i++)
+        theme_acquire(&curr_theme()->dialog_btns_dscs[i]);
+}
 
-    draw_buttons();
+static void dialog_release_images() {
+    theme_release(&curr_theme()->dialog_bg_dsc);
+    theme_release(&curr_theme()->star_dscs[1]);
 
-    lv_group_focus_obj(g_list_buttons[i % MAX_LIST_ROWS]);
+    for (int i = 0; i < 2; i++)
+        theme_release(&curr_theme()->dialog_btns_dscs[i]);
 }
 
-static void focus_cb(lv_group_t *group, lv_style_t *style) { }
-
 static void exit_dialog() {
     lv_obj_del(g_dialog_cover);
     g_dialog_cover = NULL;
 
+    dialog_release_images();
+
+    app_entry_free_icon_big(g_dialog_entry);
     g_dialog_entry = NULL;
 
     for (int i = 0; i < num_buttons(); i++) {
@@ -230,34 +370,42 @@ static void dialog_button_event(lv_obj_t *obj, lv_event_t event) {
 
             switch (btn_idx) {
                 case DialogButton_delete: {
-                    app_entry_delete(g_dialog_entry);
-
-                    lv_obj_del(g_dialog_cover);
-                    g_dialog_cover = NULL;
+                    app_entry_t *entry = g_dialog_entry;
+                    exit_dialog();
 
-                    del_buttons();
-                    free_current_app_icons();
+                    // Even if deleting fails partway, the app is gone from the list once its file is
+                    if (app_entry_delete(entry) != LV_RES_OK && is_file(entry->path))
+                        break;
 
-                    lv_ll_clear(&g_apps_ll);
-                    gen_apps_list();
+                    int old_num_buttons = num_buttons();
 
-                    if (num_buttons() <= 0)
-                        g_curr_page--;
+                    s32 idx = app_catalog_remove(&g_apps, entry);
+                    if (idx < 0)
+                        break;
 
-                    draw_buttons();
+                    // Focus whatever took the place of the deleted app
+                    reset_menu_focused_on(LV_MATH_MIN(idx, (s32) g_apps.len - 1), idx, old_num_buttons);
                 } break;
 
                 case DialogButton_load: {
-                    app_entry_load(g_dialog_entry);
+                    app_entry_load(g_dialog_entry, NULL);
                 } break;
 
                 case DialogButton_star: {
-                    app_entry_set_star(g_dialog_entry, !g_dialog_entry->starred);
+                    app_entry_t *entry = g_dialog_entry;
+                    s32 old_idx = g_curr_page * MAX_LIST_ROWS + g_list_index;
+                    exit_dialog();
+
+                    if (app_entry_set_star(entry, !entry->starred) != LV_RES_OK)
+                        break;
 
-                    lv_obj_del(g_dialog_cover);
-                    g_dialog_cover = NULL;
+                    int old_num_buttons = num_buttons();
 
-                    reset_menu_focused_on(g_dialog_entry->path);
+                    s32 idx = app_catalog_reposition(&g_apps, entry);
+                    if (idx < 0)
+                        break;
+
+                    reset_menu_focused_on(idx, LV_MATH_MIN(idx, old_idx), old_num_buttons);
                 } break;
                 
                 case DialogButton_back: {
@@ -272,6 +420,9 @@ static void draw_app_dialog() {
     g_curr_focused_tmp = g_list_buttons[g_list_index];
     g_dialog_entry = g_list_entries[g_list_index];
 
+    app_entry_init_icon_big(g_dialog_entry);
+    dialog_acquire_images();
+
     lv_event_send(g_curr_focused_tmp, LV_EVENT_DEFOCUSED, NULL);
     lv_group_remove_all_objs(keypad_group());
 
@@ -478,7 +629,27 @@ static void arrow_button_event(lv_obj_t *obj, lv_event_t event) {
     }
 }
 
-static void draw_entry_on_obj(lv_obj_t *obj, app_entry_t *entry) {
+static inline int atlas_slot(bool sliding_in, int row) {
+    return (g_atlas_half ^ sliding_in) * MAX_LIST_ROWS + row;
+}
+
+/*
+ * Copies the entry's icon to the part of the atlas the icon object shows. Until
+ * the icon is loaded the object is hidden, so the row shows through where it goes.
+ */
+static void atlas_fill(lv_obj_t *icon, app_entry_t *entry) {
+    lv_color_t *dest = g_atlas_data + lv_img_get_offset_y(icon) * APP_ICON_SMALL_W;
+
+    bool loaded = app_entry_has_icon(entry);
+    if (loaded)
+        memcpy(dest, entry->icon_small.data, THUMB_DATA_SIZE);
+
+    lv_obj_set_hidden(icon, !loaded);
+    lv_obj_invalidate(icon);
+}
+
+// Returns the icon object, so the icon can be filled in once it's loaded
+static lv_obj_t *draw_entry_on_obj(lv_obj_t *obj, app_entry_t *entry, int slot) {
     u8 offset = (LIST_BTN_H - APP_ICON_SMALL_H) / 2;
 
     lv_obj_t *author = lv_label_create(obj, NULL);
@@ -492,9 +663,14 @@ static void draw_entry_on_obj(lv_obj_t *obj, app_entry_t *entry) {
     lv_obj_align(ver, NULL, LV_ALIGN_IN_TOP_RIGHT, -offset, offset);
     
     lv_obj_t *icon_small = lv_img_create(obj, NULL);
-    lv_img_set_src(icon_small, &entry->icon_small);
+    lv_img_set_auto_size(icon_small, false);
+    lv_img_set_src(icon_small, &g_atlas);
+    lv_obj_set_size(icon_small, APP_ICON_SMALL_W, APP_ICON_SMALL_H);
+    lv_img_set_offset_y(icon_small, slot * APP_ICON_SMALL_H);
     lv_obj_align(icon_small, NULL, LV_ALIGN_IN_LEFT_MID, offset, 0);
 
+    atlas_fill(icon_small, entry);
+
     if (entry->starred) {
         lv_obj_t *star = lv_img_create(obj, NULL);
         lv_img_set_src(star, &curr_theme()->star_dscs[0]);
@@ -507,6 +683,107 @@ static void draw_entry_on_obj(lv_obj_t *obj, app_entry_t *entry) {
     lv_label_set_align(name, LV_LABEL_ALIGN_LEFT);
     lv_label_set_long_mode(name, LV_LABEL_LONG_CROP);
     lv_obj_align(name, icon_small, LV_ALIGN_OUT_RIGHT_MID, 10, 0);
+
+    return icon_small;
+}
+
+// Icons are loaded in the background, a placeholder is shown until then
+static void request_icon(app_entry_t *entry) {
+    if (app_entry_has_icon(entry))
+        return;
+
+    if (icons_request(entry, g_icon_gen) != LV_RES_OK)
+        app_entry_init_icon(entry);
+}
+
+// Shows the entry in a row, taking its icon over if it was prefetched
+static lv_obj_t *show_entry_on_obj(lv_obj_t *obj, app_entry_t *entry, int slot) {
+    prefetch_take(entry);
+    request_icon(entry);
+
+    return draw_entry_on_obj(obj, entry, slot);
+}
+
+/*
+ * Once the icons of the shown page are there, the ones of the pages around it are
+ * loaded while the user stays on it, nearest first and the paging direction first.
+ */
+static void prefetch_icons() {
+    if (g_prefetch_issued || !g_list_drawn || g_page_list_anim_running || g_page_arrow_anim_running)
+        return;
+
+    for (int i = 0; i < MAX_LIST_ROWS; i++) {
+        if (g_list_entries[i] != NULL && g_list_entries[i]->icon_pending)
+            return;
+    }
+
+    int first_dir = (g_last_page_dir < 0) ? -1 : 1;
+
+    for (int dist = 1; dist <= fmax(g_prefetch_next, g_prefetch_prev); dist++) {
+        for (int j = 0; j < 2; j++) {
+            int dir = (j == 0) ? first_dir : -first_dir;
+            if (dist > ((dir > 0) ? g_prefetch_next : g_prefetch_prev))
+                continue;
+
+            int page = g_curr_page + dir * dist;
+            if (page < 0)
+                continue;
+
+            for (int i = 0; i < MAX_LIST_ROWS; i++) {
+                app_entry_t *entry = app_catalog_get(&g_apps, page * MAX_LIST_ROWS + i);
+                if (entry == NULL)
+                    break;
+
+                if (app_entry_has_icon(entry))
+                    continue;
+
+                // The queue is full, the rest is tried again later
+                if (icons_request(entry, g_icon_gen) != LV_RES_OK)
+                    return;
+            }
+        }
+    }
+
+    g_prefetch_issued = true;
+}
+
+static void icon_done_cb(app_entry_t *entry, void *data) {
+    // Loaded synchronously in the meantime
+    if (app_entry_has_icon(entry)) {
+        icon_pool_release(data);
+        return;
+    }
+
+    for (int i = 0; i < MAX_LIST_ROWS; i++) {
+        lv_obj_t *icon = NULL;
+
+        if (g_list_icons[i] != NULL && g_list_entries[i] == entry)
+            icon = g_list_icons[i];
+        else if (g_list_icons_tmp[i] != NULL && g_list_entries_tmp[i] == entry)
+            icon = g_list_icons_tmp[i];
+
+        if (icon != NULL) {
+            app_entry_set_icon(entry, data);
+
+            // Only the icon's area gets redrawn
+            atlas_fill(icon, entry);
+            return;
+        }
+    }
+
+    if (g_num_prefetched < PREFETCH_MAX_PAGES * MAX_LIST_ROWS && in_prefetch_window(entry)) {
+        app_entry_set_icon(entry, data);
+        g_prefetched[g_num_prefetched++] = entry;
+        return;
+    }
+
+    // The row it was for is gone
+    icon_pool_release(data);
+}
+
+static void icons_task(lv_task_t *task) {
+    icons_poll(icon_done_cb);
+    prefetch_icons();
 }
 
 static void draw_arrow_button(int idx) {
@@ -532,9 +809,9 @@ static void list_ready_cb(lv_anim_t *anim) {
     int anim_idx = (lv_obj_get_y(anim_obj) - (LV_VER_RES_MAX - LIST_BTN_H * MAX_LIST_ROWS) / 2) / LIST_BTN_H;
 
     app_entry_t *entry = g_list_entries[anim_idx];
+    g_list_entries[anim_idx] = NULL;
 
-    if (entry != NULL)
-        app_entry_free_icon(entry);
+    release_icon(entry);
 
     if (g_list_buttons_tmp[anim_idx] != NULL) {
         lv_obj_set_parent(g_list_buttons_tmp[anim_idx], lv_scr_act());
@@ -546,14 +823,17 @@ static void list_ready_cb(lv_anim_t *anim) {
 
     g_list_buttons[anim_idx] = g_list_buttons_tmp[anim_idx];
     g_list_covers[anim_idx] = g_list_covers_tmp[anim_idx];
+    g_list_icons[anim_idx] = g_list_icons_tmp[anim_idx];
     g_list_entries[anim_idx] = g_list_entries_tmp[anim_idx];
 
     g_list_buttons_tmp[anim_idx] = NULL;
     g_list_covers_tmp[anim_idx] = NULL;
+    g_list_icons_tmp[anim_idx] = NULL;
     g_list_entries_tmp[anim_idx] = NULL;
     
     if (anim_idx == MAX_LIST_ROWS - 1) {
         g_page_list_anim_running = false;
+        g_atlas_half ^= 1;
 
         if (!g_page_arrow_anim_running)
             page_anim_cleanup();
@@ -620,7 +900,9 @@ static void change_page(int dir) {
     }
 
     g_curr_page += dir;
-    app_entry_t *entry = get_app_for_button(0);
+    g_icon_gen++;
+
+    move_prefetch_window(dir);
 
     for (int i = 0; i < num_buttons(); i++) {
         g_list_buttons_tmp[i] = lv_imgbtn_create(anim_objs[i], g_list_buttons[0]);
@@ -628,17 +910,19 @@ static void change_page(int dir) {
 
         g_list_covers_tmp[i] = lv_obj_create(g_list_buttons_tmp[i], g_list_covers[0]);
 
-        if (i > 0)
-            entry = lv_ll_get_next(&g_apps_ll, entry);
-
+        app_entry_t *entry = get_app_for_button(i);
         g_list_entries_tmp[i] = entry;
 
-        app_entry_init_icon(entry);
-        draw_entry_on_obj(g_list_covers_tmp[i], entry);
+        g_list_icons_tmp[i] = show_entry_on_obj(g_list_covers_tmp[i], entry, atlas_slot(true, i));
 
         lv_obj_align(g_list_buttons_tmp[i], anim_objs[i], (dir < 0) ? LV_ALIGN_IN_LEFT_MID : LV_ALIGN_IN_RIGHT_MID, 0, 0);
     }
 
+    trim_prefetched();
+
+    // Icons already queued for the new page were moved to this generation, the rest can be dropped
+    icons_cancel(g_icon_gen);
+
     for (int i = 0; i < MAX_LIST_ROWS; i++) {
         lv_anim_set_exec_cb(&g_page_list_anims[i], anim_objs[i], (lv_anim_exec_xcb_t) lv_obj_set_x);
         lv_anim_set_values(&g_page_list_anims[i], lv_obj_get_x(anim_objs[i]), lv_obj_get_x(anim_objs[i]) + ((dir < 0) ? 1 : -1) * LV_HOR_RES_MAX);
@@ -669,7 +953,41 @@ static void change_page(int dir) {
         lv_anim_create(&g_page_arrow_anims[i]);
 }
 
+static void draw_list_button(int idx) {
+    if (idx == 0) {
+        g_list_buttons[0] = lv_imgbtn_create(lv_scr_act(), NULL);
+        lv_group_add_obj(keypad_group(), g_list_buttons[0]);
+        lv_obj_set_event_cb(g_list_buttons[0], list_button_event);
+    } else {
+        g_list_buttons[idx] = lv_imgbtn_create(lv_scr_act(), g_list_buttons[idx - 1]);
+    }
+
+    // The button it's copied from might be focused
+    lv_imgbtn_set_src(g_list_buttons[idx], LV_BTN_STATE_REL, &curr_theme()->list_btns_dscs[0]);
+    lv_imgbtn_set_src(g_list_buttons[idx], LV_BTN_STATE_PR, &curr_theme()->list_btns_dscs[0]);
+
+    if (idx == 0) {
+        lv_obj_align(g_list_buttons[0], NULL, LV_ALIGN_IN_TOP_MID, 0, (LV_VER_RES_MAX - LIST_BTN_H * MAX_LIST_ROWS) / 2);
+
+        g_list_covers[0] = lv_obj_create(g_list_buttons[0], NULL);
+        lv_obj_set_event_cb(g_list_covers[0], list_button_event);
+        lv_obj_set_style(g_list_covers[0], &g_transp_style);
+        lv_obj_set_size(g_list_covers[0], LIST_BTN_W, LIST_BTN_H);
+    } else {
+        lv_obj_align(g_list_buttons[idx], g_list_buttons[idx - 1], LV_ALIGN_OUT_BOTTOM_MID, 0, 0);
+
+        g_list_covers[idx] = lv_obj_create(g_list_buttons[idx], g_list_covers[idx - 1]);
+    }
+
+    app_entry_t *entry = get_app_for_button(idx);
+    g_list_entries[idx] = entry;
+
+    g_list_icons[idx] = show_entry_on_obj(g_list_covers[idx], entry, atlas_slot(false, idx));
+}
+
 static void draw_buttons() {
+    g_list_drawn = true;
+
     while (num_buttons() <= 0 && g_curr_page > 0)
         g_curr_page--;
 
@@ -687,36 +1005,8 @@ static void draw_buttons() {
 
     lv_group_set_style_mod_cb(keypad_group(), focus_cb);
 
-    g_list_buttons[0] = lv_imgbtn_create(lv_scr_act(), NULL);
-    lv_group_add_obj(keypad_group(), g_list_buttons[0]);
-    lv_obj_set_event_cb(g_list_buttons[0], list_button_event);
-    lv_imgbtn_set_src(g_list_buttons[0], LV_BTN_STATE_REL, &curr_theme()->list_btns_dscs[0]);
-    lv_imgbtn_set_src(g_list_buttons[0], LV_BTN_STATE_PR, &curr_theme()->list_btns_dscs[0]);
-    lv_obj_align(g_list_buttons[0], NULL, LV_ALIGN_IN_TOP_MID, 0, (LV_VER_RES_MAX - LIST_BTN_H * MAX_LIST_ROWS) / 2);
-
-    g_list_covers[0] = lv_obj_create(g_list_buttons[0], NULL);
-    lv_obj_set_event_cb(g_list_covers[0], list_button_event);
-    lv_obj_set_style(g_list_covers[0], &g_transp_style);
-    lv_obj_set_size(g_list_covers[0], LIST_BTN_W, LIST_BTN_H);
-
-    app_entry_t *entry = get_app_for_button(0);
-    g_list_entries[0] = entry;
-
-    app_entry_init_icon(entry);
-    draw_entry_on_obj(g_list_covers[0], entry);
-
-    for (int i = 1; i < num_buttons(); i++) {
-        g_list_buttons[i] = lv_imgbtn_create(lv_scr_act(), g_list_buttons[i - 1]);
-        g_list_covers[i] = lv_obj_create(g_list_buttons[i], g_list_covers[i - 1]);
-
-        entry = lv_ll_get_next(&g_apps_ll, entry);
-        g_list_entries[i] = entry;
-
-        app_entry_init_icon(entry);
-        draw_entry_on_obj(g_list_covers[i], entry);
-
-        lv_obj_align(g_list_buttons[i], g_list_buttons[i - 1], LV_ALIGN_OUT_BOTTOM_MID, 0, 0);
-    }
+    for (int i = 0; i < num_buttons(); i++)
+        draw_list_button(i);
 
     lv_event_send(g_list_buttons[0], LV_EVENT_FOCUSED, NULL);
 
@@ -738,6 +1028,71 @@ static void draw_buttons() {
     }
 }
 
+// Redraws only the rows of the current page whose entry changed after apps were added, moved or removed
+static void update_buttons(s32 first_changed, int old_num_buttons) {
+    int page_start = g_curr_page * MAX_LIST_ROWS;
+
+    for (int i = fmax(first_changed - page_start, 0); i < fmin(old_num_buttons, num_buttons()); i++) {
+        app_entry_t *entry = get_app_for_button(i);
+        if (entry == g_list_entries[i])
+            continue;
+
+        app_entry_t *old_entry = g_list_entries[i];
+        g_list_entries[i] = entry;
+
+        release_icon(old_entry);
+        lv_obj_clean(g_list_covers[i]);
+
+        g_list_icons[i] = show_entry_on_obj(g_list_covers[i], entry, atlas_slot(false, i));
+    }
+
+    for (int i = num_buttons(); i < old_num_buttons; i++) {
+        app_entry_t *old_entry = g_list_entries[i];
+        g_list_entries[i] = NULL;
+
+        release_icon(old_entry);
+        lv_obj_del(g_list_buttons[i]);
+
+        g_list_buttons[i] = NULL;
+        g_list_covers[i] = NULL;
+        g_list_icons[i] = NULL;
+    }
+
+    for (int i = old_num_buttons; i < num_buttons(); i++)
+        draw_list_button(i);
+
+    // The catalog changed, so the prefetched pages might hold other apps now
+    trim_prefetched();
+
+    if (!on_last_page() && g_arrow_buttons[0] == NULL) {
+        draw_arrow_button(0);
+    } else if (on_last_page() && g_arrow_buttons[0] != NULL) {
+        lv_obj_del(g_arrow_buttons[0]);
+        g_arrow_buttons[0] = NULL;
+    }
+}
+
+static void apps_load_task(lv_task_t *task) {
+    // New apps are left pending while the page is changing or a dialog is open
+    if (g_page_list_anim_running || g_page_arrow_anim_running || g_dialog_cover != NULL)
+        return;
+
+    int old_num_buttons = num_buttons();
+
+    s32 first_changed = app_catalog_poll(&g_apps);
+
+    if (!g_list_drawn) {
+        // Draw the first page as soon as it's full, or once there's nothing more to come
+        if (g_apps.len >= MAX_LIST_ROWS || !app_catalog_loading(&g_apps))
+            draw_buttons();
+    } else if (first_changed >= 0) {
+        update_buttons(first_changed, old_num_buttons);
+    }
+
+    if (!app_catalog_loading(&g_apps))
+        lv_task_del(task);
+}
+
 void setup_screen() {
     lv_obj_t *scr = lv_img_create(NULL, NULL);
     lv_img_set_src(scr, &curr_theme()->background_dsc);
@@ -753,13 +1108,23 @@ void setup_menu() {
     g_transp_style.body.padding.bottom = 0;
 
     gen_apps_list();
-    draw_buttons();
+    icons_init();
+
+    // Until the user pages, both sides get the same share of the budget
+    g_prefetch_next = fmin(1, prefetch_max_pages());
+    g_prefetch_prev = fmin(1, prefetch_max_pages() - g_prefetch_next);
+
+    lv_task_t *task = lv_task_create(apps_load_task, 20, LV_TASK_PRIO_MID, NULL);
+    lv_task_ready(task);
+
+    lv_task_create(icons_task, 20, LV_TASK_PRIO_MID, NULL);
 }
 
 static void remote_cover_event_cb(lv_obj_t *obj, lv_event_t event) {
     switch (event) {
         case LV_EVENT_DELETE:
             g_remote_cover = NULL;
+            theme_release(&curr_theme()->remote_progress_dsc);
             lv_group_focus_freeze(keypad_group(), false);
 
             struct timespec sleep = {.tv_nsec = 100000000};
@@ -791,6 +1156,7 @@ static void remote_progress_task(lv_task_t *task) {
     if (remote_loader_get_activated(g_remote_loader)) {
         if (g_remote_cover == NULL) {
             lv_group_focus_freeze(keypad_group(), true);
+            theme_acquire(&curr_theme()->remote_progress_dsc);
 
             g_remote_cover = lv_obj_create(lv_scr_act(), NULL);
             lv_obj_set_event_cb(g_remote_cover, remote_cover_event_cb);
@@ -1003,4 +1369,16 @@ void gui_exit() {
     }
     
     status_exit();
+
+    // The scan threads have to be done with the SD card before anything is torn down
+    app_catalog_cancel(&g_apps);
+    icons_exit();
+
+    apps_index_save();
+
+    // Saving would end the import from the star files with only the apps seen so far
+    if (!favorites_importing())
+        favorites_save();
+
+    app_catalog_clear(&g_apps);
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include <threads.h>
+#include <lvgl/lvgl.h>
+#include <switch.h>
+
+#include "icon_pool.h"
+#include "log.h"
+
+typedef struct {
+    u64 hash;
+    void *data;
+    u32 refs;
+} pooled_icon_t;
+
+static pooled_icon_t *g_icons = NULL;
+static u32 g_num_icons = 0;
+static u32 g_icons_cap = 0;
+
+// How many icons were asked for, and how many of them had to be read and decoded
+static u32 g_num_loaded = 0;
+static u32 g_num_unique = 0;
+
+static mtx_t g_pool_mtx;
+static bool g_mtx_init = false;
+
+void icon_pool_init() {
+    if (!g_mtx_init) {
+        mtx_init(&g_pool_mtx, mtx_plain);
+        g_mtx_init = true;
+    }
+}
+
+static pooled_icon_t *find_icon(u64 hash) {
+    for (u32 i = 0; i < g_num_icons; i++) {
+        if (g_icons[i].hash == hash)
+            return &g_icons[i];
+    }
+
+    return NULL;
+}
+
+void *icon_pool_acquire(u64 hash) {
+    mtx_lock(&g_pool_mtx);
+
+    void *data = NULL;
+
+    pooled_icon_t *icon = find_icon(hash);
+    if (icon != NULL) {
+        icon->refs++;
+        data = icon->data;
+
+        g_num_loaded++;
+    }
+
+    mtx_unlock(&g_pool_mtx);
+
+    return data;
+}
+
+void *icon_pool_add(u64 hash, void *data) {
+    mtx_lock(&g_pool_mtx);
+
+    g_num_loaded++;
+
+    // Another thread might've loaded the same icon at the same time
+    pooled_icon_t *icon = find_icon(hash);
+    if (icon != NULL) {
+        icon->refs++;
+        // The entry can move or be removed as soon as the lock is dropped
+        void *shared = icon->data;
+
+        mtx_unlock(&g_pool_mtx);
+
+        free(data);
+        return shared;
+    }
+
+    if (g_num_icons == g_icons_cap) {
+        u32 new_cap = (g_icons_cap == 0) ? 64 : g_icons_cap * 2;
+
+        pooled_icon_t *new_icons = realloc(g_icons, new_cap * sizeof(pooled_icon_t));
+        if (new_icons == NULL) {
+            mtx_unlock(&g_pool_mtx);
+
+            free(data);
+            return NULL;
+        }
+
+        g_icons = new_icons;
+        g_icons_cap = new_cap;
+    }
+
+    g_icons[g_num_icons++] = (pooled_icon_t) {
+        .hash = hash,
+        .data = data,
+        .refs = 1,
+    };
+
+    g_num_unique++;
+
+    mtx_unlock(&g_pool_mtx);
+
+    return data;
+}
+
+void icon_pool_release(void *data) {
+    if (data == NULL)
+        return;
+
+    mtx_lock(&g_pool_mtx);
+
+    for (u32 i = 0; i < g_num_icons; i++) {
+        if (g_icons[i].data != data)
+            continue;
+
+        if (--g_icons[i].refs == 0) {
+            free(data);
+            g_icons[i] = g_icons[--g_num_icons];
+        }
+
+        break;
+    }
+
+    mtx_unlock(&g_pool_mtx);
+}
+
+void icon_pool_log_stats() {
+    mtx_lock(&g_pool_mtx);
+
+    u32 shared = 0;
+    for (u32 i = 0; i < g_num_icons; i++)
+        shared += g_icons[i].refs;
+
+    logPrintf("icon pool: %u loaded, %u unique (%u%% deduplicated), %u in use by %u apps\n",
+        g_num_loaded, g_num_unique,
+        (g_num_loaded == 0) ? 0 : (g_num_loaded - g_num_unique) * 100 / g_num_loaded,
+        g_num_icons, shared);
+
+    mtx_unlock(&g_pool_mtx);
+}
\ No newline at end of file
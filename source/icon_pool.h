@@ -0,0 +1,26 @@
+#pragma once
+
+#include <lvgl/lvgl.h>
+#include <switch.h>
+
+/*
+ * Decoded small icons, shared by the apps whose icons have the same content hash.
+ * Can be used from any thread.
+ */
+
+// Has to be called before any of the other functions
+void icon_pool_init();
+
+// Returns the icon with the hash and takes a reference to it, or NULL if there's none
+void *icon_pool_acquire(u64 hash);
+
+/*
+ * Adds icon data from malloc, which the pool takes ownership of. If an icon
+ * with the same hash was added in the meantime, the data is freed and that
+ * icon is returned instead. Either way a reference is taken.
+ */
+void *icon_pool_add(u64 hash, void *data);
+
+void icon_pool_release(void *data);
+
+void icon_pool_log_stats();
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <threads.h>
+#include <lvgl/lvgl.h>
+#include <switch.h>
+
+#include "icons.h"
+#include "apps.h"
+#include "icon_pool.h"
+#include "log.h"
+
+#define ICON_FIRST_CORE 1
+
+typedef struct {
+    app_entry_t *entry;
+    u32 generation;
+    void *data;
+    // The loaders only update this copy, it's applied to the entry on the UI thread
+    app_icon_loc_t loc;
+} icon_job_t;
+
+static thrd_t g_threads[ICON_THREADS];
+static int g_num_threads = 0;
+
+static mtx_t g_icons_mtx;
+static cnd_t g_icons_cnd;
+
+// Both are in the order the requests were made
+static icon_job_t g_pending[ICON_QUEUE_LEN];
+static u32 g_pending_len = 0;
+static icon_job_t g_done[ICON_QUEUE_LEN];
+static u32 g_done_len = 0;
+
+static u32 g_outstanding = 0; // Pending, being loaded or done but not handed over yet
+static bool g_exit = false;
+
+static atomic_uint g_next_core;
+
+static int icons_thread(void *arg) {
+    // Keep the loading off the core the UI thread is on
+    s32 core = ICON_FIRST_CORE + atomic_fetch_add(&g_next_core, 1) % ICON_THREADS;
+    svcSetThreadCoreMask(CUR_THREAD_HANDLE, core, BIT(core));
+
+    mtx_lock(&g_icons_mtx);
+
+    while (true) {
+        while (g_pending_len == 0 && !g_exit)
+            cnd_wait(&g_icons_cnd, &g_icons_mtx);
+
+        if (g_exit)
+            break;
+
+        icon_job_t job = g_pending[0];
+        memmove(&g_pending[0], &g_pending[1], --g_pending_len * sizeof(icon_job_t));
+
+        mtx_unlock(&g_icons_mtx);
+        job.data = app_entry_load_icon(job.entry, &job.loc);
+        mtx_lock(&g_icons_mtx);
+
+        g_done[g_done_len++] = job;
+    }
+
+    mtx_unlock(&g_icons_mtx);
+
+    return 0;
+}
+
+lv_res_t icons_init() {
+    mtx_init(&g_icons_mtx, mtx_plain);
+    cnd_init(&g_icons_cnd);
+
+    atomic_init(&g_next_core, 0);
+
+    for (int i = 0; i < ICON_THREADS; i++) {
+        if (thrd_create(&g_threads[g_num_threads], icons_thread, NULL) == thrd_success)
+            g_num_threads++;
+    }
+
+    return (g_num_threads > 0) ? LV_RES_OK : LV_RES_INV;
+}
+
+void icons_exit() {
+    mtx_lock(&g_icons_mtx);
+    g_exit = true;
+    cnd_broadcast(&g_icons_cnd);
+    mtx_unlock(&g_icons_mtx);
+
+    for (int i = 0; i < g_num_threads; i++)
+        thrd_join(g_threads[i], NULL);
+
+    g_num_threads = 0;
+
+    for (u32 i = 0; i < g_done_len; i++)
+        icon_pool_release(g_done[i].data);
+
+    g_pending_len = 0;
+    g_done_len = 0;
+    g_outstanding = 0;
+
+    cnd_destroy(&g_icons_cnd);
+    mtx_destroy(&g_icons_mtx);
+}
+
+lv_res_t icons_request(app_entry_t *entry, u32 generation) {
+    if (g_num_threads == 0)
+        return LV_RES_INV;
+
+    mtx_lock(&g_icons_mtx);
+
+    // It might've been requested for a page that was left and is now being shown again
+    if (entry->icon_pending) {
+        for (u32 i = 0; i < g_pending_len; i++) {
+            if (g_pending[i].entry == entry)
+                g_pending[i].generation = generation;
+        }
+
+        mtx_unlock(&g_icons_mtx);
+        return LV_RES_OK;
+    }
+
+    if (g_outstanding >= ICON_QUEUE_LEN) {
+        mtx_unlock(&g_icons_mtx);
+        return LV_RES_INV;
+    }
+
+    g_pending[g_pending_len++] = (icon_job_t) {
+        .entry = entry,
+        .generation = generation,
+        .loc = entry->icon_loc,
+    };
+
+    g_outstanding++;
+    entry->icon_pending = true;
+
+    cnd_signal(&g_icons_cnd);
+    mtx_unlock(&g_icons_mtx);
+
+    return LV_RES_OK;
+}
+
+void icons_cancel(u32 generation) {
+    mtx_lock(&g_icons_mtx);
+
+    u32 kept = 0;
+
+    for (u32 i = 0; i < g_pending_len; i++) {
+        if (g_pending[i].generation >= generation) {
+            g_pending[kept++] = g_pending[i];
+        } else {
+            g_pending[i].entry->icon_pending = false;
+            g_outstanding--;
+        }
+    }
+
+    g_pending_len = kept;
+
+    mtx_unlock(&g_icons_mtx);
+}
+
+void icons_poll(icons_done_cb_t cb) {
+    icon_job_t done[ICON_QUEUE_LEN];
+
+    mtx_lock(&g_icons_mtx);
+
+    u32 done_len = g_done_len;
+    memcpy(done, g_done, done_len * sizeof(icon_job_t));
+
+    g_done_len = 0;
+    g_outstanding -= done_len;
+
+    bool drained = done_len > 0 && g_outstanding == 0;
+
+    mtx_unlock(&g_icons_mtx);
+
+    for (u32 i = 0; i < done_len; i++) {
+        done[i].entry->icon_loc = done[i].loc;
+        done[i].entry->icon_pending = false;
+
+        if (done[i].data != NULL)
+            cb(done[i].entry, done[i].data);
+    }
+
+    if (drained)
+        icon_pool_log_stats();
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <lvgl/lvgl.h>
+#include <switch.h>
+
+#include "apps.h"
+
+#define ICON_THREADS 2
+#define ICON_QUEUE_LEN 64
+
+// Called on the UI thread with the loaded data, which it takes ownership of
+typedef void (*icons_done_cb_t)(app_entry_t *entry, void *data);
+
+lv_res_t icons_init();
+void icons_exit();
+
+/*
+ * Loads the small icon of the entry in the background. Requests are tagged
+ * with a generation, so the ones for pages that aren't shown anymore can be
+ * cancelled. Fails if too many icons are already being loaded.
+ */
+lv_res_t icons_request(app_entry_t *entry, u32 generation);
+// Drops the requests from before the generation that haven't been started yet
+void icons_cancel(u32 generation);
+
+// Hands the finished icons over, the callback has to release the ones it doesn't need anymore
+void icons_poll(icons_done_cb_t cb);
\ No newline at end of file
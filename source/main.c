@@ -43,11 +43,12 @@ int main(int argc, char **argv) {
     lv_init();
     
     settings_init();
+
+    // Theme packs have JPEGs, which go through the decoder
+    decoderInitialize();
     theme_init();
 
     driversInitialize();
-    
-    decoderInitialize();
 
     setup_screen();
     setup_menu();
@@ -69,6 +70,7 @@ int main(int argc, char **argv) {
 
     gui_exit();
 
+    decoderExit();
     driversExit();
     theme_exit();
     logExit();
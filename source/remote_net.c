@@ -292,7 +292,7 @@ static void net_add_args_cb(remote_loader_t *r) {
     char arg[17];
     sprintf(arg, "%08x_NXLINK_", data->host);
 
-    app_entry_add_arg(&r->entry, arg);
+    app_args_add(r->args, arg);
 }
 
 static remote_loader_t g_net_loader = {
@@ -23,6 +23,10 @@ static settings_t g_default_settings = {
     .remote_type = RemoteLoaderType_net,
 
     .lang_id = SetLanguage_ENUS,
+
+    .app_scan_limit = 256,
+    .icon_cache_budget = 0x100000,
+    .icon_prefetch_budget = 0x80000,
 };
 
 static settings_t g_curr_settings;
@@ -79,6 +83,17 @@ lv_res_t settings_init() {
             tmp_int = g_default_settings.remote_type;
         g_curr_settings.remote_type = tmp_int;
 
+        if (config_setting_lookup_int(settings, "app_scan_limit", &tmp_int) != CONFIG_TRUE || tmp_int <= 0)
+            tmp_int = g_default_settings.app_scan_limit;
+        g_curr_settings.app_scan_limit = tmp_int;
+
+        if (config_setting_lookup_int(settings, "icon_cache_budget", &tmp_int) != CONFIG_TRUE || tmp_int < 0)
+            tmp_int = g_default_settings.icon_cache_budget;
+        g_curr_settings.icon_cache_budget = tmp_int;
+
+        if (config_setting_lookup_int(settings, "icon_prefetch_budget", &tmp_int) != CONFIG_TRUE || tmp_int < 0)
+            tmp_int = g_default_settings.icon_prefetch_budget;
+        g_curr_settings.icon_prefetch_budget = tmp_int;
 
         if (config_setting_lookup_string(settings, "language", &tmp_str) == CONFIG_TRUE)
             lang_code = str_to_lang_code(tmp_str);
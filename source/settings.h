@@ -24,6 +24,10 @@ typedef struct {
     RemoteLoaderType remote_type;
 
     u8 lang_id;
+
+    u32 app_scan_limit; // How many entries of an app folder are looked at to find the app
+    u32 icon_cache_budget; // Bytes of decoded icons kept around
+    u32 icon_prefetch_budget; // Bytes of list icons loaded ahead for the pages next to the shown one
 } settings_t;
 
 lv_res_t settings_init();
@@ -17,6 +17,8 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <stdio.h>
+#include <string.h>
 #include <minizip/unzip.h>
 #include <libconfig.h>
 #include <threads.h>
@@ -24,8 +26,10 @@
 #include <switch.h>
 
 #include "theme.h"
+#include "decoder.h"
 #include "settings.h"
 #include "log.h"
+#include "util.h"
 
 #ifdef MUSIC
 
@@ -33,9 +37,68 @@
 
 #endif
 
-#define DEFAULT_THEME_PATH "romfs:/theme.zip"
+#define DEFAULT_THEME_PATH "romfs:/theme.pack"
+
+#define THEME_PACK_MAGIC 0x50544248 // "HBTP"
+#define THEME_PACK_VERSION 2
+#define THEME_PACK_NAME_LEN 48
+
+/*
+ * Theme packs are the header, then the index, then each file's data at an
+ * offset aligned to 16 bytes. Files are stored in an encoding that's fast
+ * to decode. Images are LZ4 blocks, or JPEGs if they're opaque and the pack
+ * was generated with --jpeg.
+ */
+typedef enum {
+    ThemeEncoding_raw,
+    ThemeEncoding_lz4,
+    ThemeEncoding_jpeg, // Decoded to BGRA
+} ThemeEncoding;
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 count;
+    u32 reserved;
+} theme_pack_header_t;
+
+typedef struct {
+    char name[THEME_PACK_NAME_LEN];
+    u32 offset;
+    u32 size; // As it's stored
+    u16 encoding;
+    u16 reserved;
+    u32 raw_size; // Once it's decoded
+} theme_pack_entry_t;
+
+// Where a file of a theme is, so it can be read without searching the archive
+typedef struct {
+    u32 hash;
+    char name[THEME_PACK_NAME_LEN];
+
+    unz_file_pos zip_pos;
+
+    u32 pack_offset;
+    u32 pack_size;
+    u32 pack_raw_size;
+    u16 pack_encoding;
+} theme_file_t;
+
+// A theme is either a zip or a pack, told apart by the magic
+typedef struct {
+    unzFile zf;
+    FILE *pack_fp;
+
+    // Filled in once when the theme is opened
+    theme_file_t *files;
+    u32 num_files;
+} theme_src_t;
 
 #define GEN_ASSET(x) {.file_name = x}
+#define GEN_LAZY_ASSET(x) {.file_name = x, .lazy = true}
+
+// Released lazy images are evicted when less than this is left in LVGL's heap
+#define THEME_EVICT_FREE_MIN (16 * 1024 * 1024)
 
 typedef enum {
     AssetId_background,
@@ -68,7 +131,7 @@ typedef enum {
 
 static asset_t g_assets_list[AssetId_max] = {
     GEN_ASSET("background.bin"),
-    GEN_ASSET("cursor.bin"),
+    GEN_LAZY_ASSET("cursor.bin"),
     GEN_ASSET("apps_list.bin"),
     GEN_ASSET("apps_list_hover.bin"),
     GEN_ASSET("apps_next.bin"),
@@ -77,24 +140,33 @@ static asset_t g_assets_list[AssetId_max] = {
     GEN_ASSET("apps_previous_hover.bin"),
     GEN_ASSET("logo.bin"),
     GEN_ASSET("star_small.bin"),
-    GEN_ASSET("star_big.bin"),
-    GEN_ASSET("dialog_background.bin"),
-    GEN_ASSET("button_tiny.bin"),
-    GEN_ASSET("button_tiny_focus.bin"),
-    GEN_ASSET("remote_progress.bin"),
+    GEN_LAZY_ASSET("star_big.bin"),
+    GEN_LAZY_ASSET("dialog_background.bin"),
+    GEN_LAZY_ASSET("button_tiny.bin"),
+    GEN_LAZY_ASSET("button_tiny_focus.bin"),
+    GEN_LAZY_ASSET("remote_progress.bin"),
     GEN_ASSET("network_inactive.bin"),
     GEN_ASSET("network_active.bin"),
 
     #ifdef MUSIC
 
-    GEN_ASSET("intro.mp3"),
-    GEN_ASSET("loop.mp3"),
+    GEN_LAZY_ASSET("intro.mp3"),
+    GEN_LAZY_ASSET("loop.mp3"),
 
     #endif
 };
 
 static theme_t g_curr_theme;
 
+// Kept open so lazy assets can be loaded from them
+static theme_src_t g_src;
+static theme_src_t g_src_default;
+
+// What reading the theme cost, logged once it's loaded
+static u32 g_read_bytes;
+static u32 g_decoded_bytes;
+static u64 g_decode_ticks;
+
 static lv_task_t *g_reset_task = NULL;
 static bool g_should_reset = false;
 static mtx_t g_reset_mtx;
@@ -117,52 +189,359 @@ static int config_setting_lookup_color(config_setting_t *setting, const char *na
     return ret;
 }
 
-static int asset_load(asset_t *asset, unzFile zf) {
-    int ret = unzLocateFile(zf, asset->file_name, 0);
+static lv_res_t theme_pack_open(theme_src_t *src, FILE *fp) {
+    theme_pack_header_t header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != THEME_PACK_MAGIC || header.version != THEME_PACK_VERSION)
+        return LV_RES_INV;
+
+    theme_file_t *files = lv_mem_alloc(header.count * sizeof(theme_file_t));
+    if (files == NULL)
+        return LV_RES_INV;
+
+    for (u32 i = 0; i < header.count; i++) {
+        theme_pack_entry_t entry;
+        if (fread(&entry, sizeof(entry), 1, fp) != 1) {
+            lv_mem_free(files);
+            return LV_RES_INV;
+        }
+
+        entry.name[THEME_PACK_NAME_LEN - 1] = '\0';
+
+        strcpy(files[i].name, entry.name);
+        files[i].hash = hash_str(files[i].name);
+        files[i].pack_offset = entry.offset;
+        files[i].pack_size = entry.size;
+        files[i].pack_raw_size = entry.raw_size;
+        files[i].pack_encoding = entry.encoding;
+    }
+
+    // The data is read in big chunks straight into the buffers, so there's no point in stdio's buffer
+    setvbuf(fp, NULL, _IONBF, 0);
+
+    src->pack_fp = fp;
+    src->files = files;
+    src->num_files = header.count;
+
+    return LV_RES_OK;
+}
+
+// Goes through the central directory once, instead of once for every file that's looked up
+static lv_res_t theme_zip_index(theme_src_t *src) {
+    unz_global_info global_info;
+    if (unzGetGlobalInfo(src->zf, &global_info) != UNZ_OK)
+        return LV_RES_INV;
+
+    theme_file_t *files = lv_mem_alloc(global_info.number_entry * sizeof(theme_file_t));
+    if (files == NULL)
+        return LV_RES_INV;
+
+    u32 num_files = 0;
+
+    for (int ret = unzGoToFirstFile(src->zf); ret == UNZ_OK && num_files < global_info.number_entry; ret = unzGoToNextFile(src->zf)) {
+        theme_file_t *file = &files[num_files];
+
+        // Names that don't fit can't be any of the theme's files
+        char name[THEME_PACK_NAME_LEN + 1];
+        if (unzGetCurrentFileInfo(src->zf, NULL, name, sizeof(name) - 1, NULL, 0, NULL, 0) != UNZ_OK)
+            continue;
+
+        name[sizeof(name) - 1] = '\0'; // Long names are cut off without a terminator
+        if (strlen(name) >= THEME_PACK_NAME_LEN)
+            continue;
+
+        if (unzGetFilePos(src->zf, &file->zip_pos) != UNZ_OK)
+            continue;
+
+        strcpy(file->name, name);
+        file->hash = hash_str(file->name);
+
+        num_files++;
+    }
+
+    src->files = files;
+    src->num_files = num_files;
+
+    return LV_RES_OK;
+}
+
+static void theme_src_open(theme_src_t *src, const char *path) {
+    src->zf = NULL;
+    src->pack_fp = NULL;
+    src->files = NULL;
+    src->num_files = 0;
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return;
+
+    u32 magic;
+    bool is_pack = fread(&magic, sizeof(magic), 1, fp) == 1 && magic == THEME_PACK_MAGIC;
+
+    if (is_pack) {
+        rewind(fp);
+
+        if (theme_pack_open(src, fp) != LV_RES_OK) {
+            LV_LOG_WARN("Bad theme pack");
+            fclose(fp);
+        }
+
+        return;
+    }
+
+    fclose(fp);
+
+    src->zf = unzOpen(path);
+
+    if (src->zf != NULL && theme_zip_index(src) != LV_RES_OK) {
+        LV_LOG_WARN("Bad theme zip");
+        unzClose(src->zf);
+        src->zf = NULL;
+    }
+}
+
+static void theme_src_close(theme_src_t *src) {
+    if (src->zf != NULL)
+        unzClose(src->zf);
+
+    if (src->pack_fp != NULL)
+        fclose(src->pack_fp);
+
+    lv_mem_free(src->files);
+
+    src->zf = NULL;
+    src->pack_fp = NULL;
+    src->files = NULL;
+    src->num_files = 0;
+}
+
+static bool theme_src_valid(theme_src_t *src) {
+    return src->zf != NULL || src->pack_fp != NULL;
+}
+
+static theme_file_t *theme_src_find(theme_src_t *src, const char *name) {
+    u32 hash = hash_str(name);
+
+    for (u32 i = 0; i < src->num_files; i++) {
+        if (src->files[i].hash == hash && strcmp(src->files[i].name, name) == 0)
+            return &src->files[i];
+    }
+
+    return NULL;
+}
+
+static int theme_pack_read(theme_src_t *src, theme_file_t *file, void **buffer, size_t *size) {
+    u8 *stored = lv_mem_alloc(file->pack_size + 1);
+    if (stored == NULL)
+        return -12;
+
+    if (fseek(src->pack_fp, file->pack_offset, SEEK_SET) != 0 || fread(stored, file->pack_size, 1, src->pack_fp) != 1) {
+        lv_mem_free(stored);
+        return -12;
+    }
+
+    g_read_bytes += file->pack_size;
+
+    if (file->pack_encoding == ThemeEncoding_raw) {
+        stored[file->pack_size] = '\0';
+
+        *buffer = stored;
+        *size = file->pack_size;
+
+        return UNZ_OK;
+    }
+
+    u8 *data = lv_mem_alloc(file->pack_raw_size + 1);
+    if (data == NULL) {
+        lv_mem_free(stored);
+        return -12;
+    }
+
+    u64 start = armGetSystemTick();
+
+    lv_res_t res = LV_RES_INV;
+    switch (file->pack_encoding) {
+        case ThemeEncoding_lz4:
+            if (lz4_decompress(stored, file->pack_size, data, file->pack_raw_size) == (int) file->pack_raw_size)
+                res = LV_RES_OK;
+            break;
+
+        case ThemeEncoding_jpeg:
+            res = decoderDecodeJpeg(stored, file->pack_size, data, file->pack_raw_size);
+            break;
+    }
+
+    g_decode_ticks += armGetSystemTick() - start;
+    g_decoded_bytes += file->pack_raw_size;
+
+    lv_mem_free(stored);
+
+    if (res != LV_RES_OK) {
+        LV_LOG_WARN("Bad theme pack file");
+        lv_mem_free(data);
+        return -12;
+    }
+
+    data[file->pack_raw_size] = '\0';
+
+    *buffer = data;
+    *size = file->pack_raw_size;
+
+    return UNZ_OK;
+}
+
+/*
+ * Reads a file of the theme into a buffer from lv_mem_alloc. The buffer has
+ * an extra null terminator after the data, so text files can be parsed as is.
+ */
+static int theme_src_read(theme_src_t *src, const char *name, void **buffer, size_t *size) {
+    if (!theme_src_valid(src))
+        return -1;
+
+    theme_file_t *file = theme_src_find(src, name);
+    if (file == NULL)
+        return UNZ_END_OF_LIST_OF_FILE;
+
+    if (src->pack_fp != NULL)
+        return theme_pack_read(src, file, buffer, size);
+
+    int ret = unzGoToFilePos(src->zf, &file->zip_pos);
     if (ret != UNZ_OK)
         return ret;
 
-    ret = unzOpenCurrentFile(zf);
+    ret = unzOpenCurrentFile(src->zf);
     if (ret != UNZ_OK)
         return ret;
 
     unz_file_info file_info;
-    ret = unzGetCurrentFileInfo(zf, &file_info, NULL, 0, NULL, 0, NULL, 0);
+    ret = unzGetCurrentFileInfo(src->zf, &file_info, NULL, 0, NULL, 0, NULL, 0);
     if (ret != UNZ_OK) {
-        unzCloseCurrentFile(zf);
+        unzCloseCurrentFile(src->zf);
         return ret;
     }
 
-    asset->size = file_info.uncompressed_size;
+    u8 *data = lv_mem_alloc(file_info.uncompressed_size + 1);
+    if (data == NULL) {
+        unzCloseCurrentFile(src->zf);
+        return -12;
+    }
 
-    asset->buffer = lv_mem_alloc(asset->size);
-    ret = unzReadCurrentFile(zf, asset->buffer, asset->size);
-    if (ret < asset->size) {
-        lv_mem_free(asset->buffer);
-        unzCloseCurrentFile(zf);
+    ret = unzReadCurrentFile(src->zf, data, file_info.uncompressed_size);
+    if (ret < (int) file_info.uncompressed_size) {
+        lv_mem_free(data);
+        unzCloseCurrentFile(src->zf);
         return -12;
     }
 
-    unzCloseCurrentFile(zf);
+    unzCloseCurrentFile(src->zf);
+
+    g_read_bytes += file_info.compressed_size;
+
+    data[file_info.uncompressed_size] = '\0';
+
+    *buffer = data;
+    *size = file_info.uncompressed_size;
 
     return UNZ_OK;
 }
 
+static int asset_load(asset_t *asset, theme_src_t *src) {
+    return theme_src_read(src, asset->file_name, &asset->buffer, &asset->size);
+}
+
 static void asset_clean(asset_t *asset) {
+    if (asset->dsc != NULL) {
+        lv_img_cache_invalidate_src(asset->dsc);
+
+        asset->dsc->data = NULL;
+        asset->dsc->data_size = 0;
+    }
+
     lv_mem_free(asset->buffer);
     asset->buffer = NULL;
     asset->size = 0;
 }
 
+static AssetAlpha asset_classify_alpha(asset_t *asset) {
+    const lv_color_t *px = asset->buffer;
+    size_t num_px = asset->size / sizeof(lv_color_t);
+
+    AssetAlpha alpha = AssetAlpha_opaque;
+    for (size_t i = 0; i < num_px; i++) {
+        if (px[i].ch.alpha == LV_OPA_COVER)
+            continue;
+
+        if (px[i].ch.alpha != LV_OPA_TRANSP)
+            return AssetAlpha_blended;
+
+        alpha = AssetAlpha_binary;
+    }
+
+    return alpha;
+}
+
+/*
+ * Points the descriptor at the asset's data. Opaque images are marked as such so
+ * LVGL copies them instead of blending them, and doesn't draw what's under them.
+ * Images with binary alpha keep their alpha byte, LVGL already doesn't blend
+ * pixels that are fully opaque or transparent.
+ */
+static void asset_update_dsc(asset_t *asset) {
+    lv_img_dsc_t *dsc = asset->dsc;
+
+    dsc->data = asset->buffer;
+    dsc->data_size = asset->size;
+
+    asset->alpha = AssetAlpha_blended;
+    if (asset->buffer != NULL)
+        asset->alpha = asset_classify_alpha(asset);
+
+    dsc->header.cf = asset->alpha == AssetAlpha_opaque ? LV_IMG_CF_TRUE_COLOR : LV_IMG_CF_TRUE_COLOR_ALPHA;
+}
+
+// Loads the asset from the theme, or the default one if the theme doesn't have it
+static int asset_materialize(asset_t *asset) {
+    if (asset->buffer != NULL)
+        return UNZ_OK;
+
+    int ret = -1;
+
+    if (theme_src_valid(&g_src))
+        ret = asset_load(asset, &g_src);
+
+    if (ret != UNZ_OK && theme_src_valid(&g_src_default))
+        ret = asset_load(asset, &g_src_default);
+
+    if (ret != UNZ_OK)
+        return ret;
+
+    if (asset->dsc != NULL)
+        asset_update_dsc(asset);
+
+    return UNZ_OK;
+}
+
+static bool asset_available(asset_t *asset) {
+    return theme_src_find(&g_src, asset->file_name) != NULL || theme_src_find(&g_src_default, asset->file_name) != NULL;
+}
+
+static asset_t *asset_for_dsc(const lv_img_dsc_t *dsc) {
+    for (int i = 0; i < AssetId_max; i++) {
+        if (g_assets_list[i].dsc == dsc)
+            return &g_assets_list[i];
+    }
+
+    return NULL;
+}
+
 static void asset_to_img_dsc(lv_img_dsc_t *dsc, asset_t *assets, AssetId id, u32 width, u32 height) {
     asset_t *asset = &assets[id];
+    asset->dsc = dsc;
 
     dsc->header.always_zero = 0;
     dsc->header.w = width;
     dsc->header.h = height;
-    dsc->data_size = asset->size;
-    dsc->header.cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
-    dsc->data = asset->buffer;
+
+    asset_update_dsc(asset);
 }
 
 static void theme_load_assets(theme_t *theme, asset_t *assets) {
@@ -229,36 +608,23 @@ static void theme_init_styles(theme_t *theme) {
     lv_style_copy(&theme->warn_48_style, &theme->normal_48_style);
 }
 
-static lv_res_t theme_load_styles(theme_t *theme, unzFile zf) {
-    if (zf == NULL)
-        return LV_RES_INV;
-
-    if (unzLocateFile(zf, "styles.cfg", 0) != UNZ_OK)
-        return LV_RES_INV;
-
-    if (unzOpenCurrentFile(zf) != UNZ_OK)
+static lv_res_t theme_load_styles(theme_t *theme, theme_src_t *src) {
+    if (!theme_src_valid(src))
         return LV_RES_INV;
 
-    unz_file_info file_info;
-    if (unzGetCurrentFileInfo(zf, &file_info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK) {
-        unzCloseCurrentFile(zf);
+    char *cfg_str;
+    size_t cfg_size;
+    if (theme_src_read(src, "styles.cfg", (void **) &cfg_str, &cfg_size) != UNZ_OK)
         return LV_RES_INV;
-    }
-
-    char cfg_str[file_info.uncompressed_size + 1];
-    if (unzReadCurrentFile(zf, cfg_str, file_info.uncompressed_size) < file_info.uncompressed_size) {
-        unzCloseCurrentFile(zf);
-        return LV_RES_INV;
-    }
-
-    unzCloseCurrentFile(zf);
-
-    cfg_str[file_info.uncompressed_size] = '\0';
 
     config_t cfg;
 
     config_init(&cfg);
-    if (config_read_string(&cfg, cfg_str) != CONFIG_TRUE) {
+    int cfg_res = config_read_string(&cfg, cfg_str);
+
+    lv_mem_free(cfg_str);
+
+    if (cfg_res != CONFIG_TRUE) {
         config_destroy(&cfg);
         return LV_RES_INV;
     }
@@ -314,6 +680,26 @@ static lv_res_t theme_load_styles(theme_t *theme, unzFile zf) {
     return LV_RES_OK;
 }
 
+// Images keep the color format they had when their source was set, which can change with the theme
+static void theme_refresh_imgs(lv_obj_t *parent) {
+    lv_obj_t *child = NULL;
+    while ((child = lv_obj_get_child(parent, child)) != NULL) {
+        lv_obj_type_t type;
+        lv_obj_get_type(child, &type);
+
+        if (strcmp(type.type[0], "lv_img") == 0) {
+            const void *src = lv_img_get_src(child);
+            if (asset_for_dsc(src) != NULL)
+                lv_img_set_src(child, src);
+        } else if (strcmp(type.type[0], "lv_imgbtn") == 0) {
+            // Image buttons read their image again when their style changes
+            lv_obj_refresh_style(child);
+        }
+
+        theme_refresh_imgs(child);
+    }
+}
+
 static lv_res_t theme_reset() {
     theme_exit();
 
@@ -321,6 +707,8 @@ static lv_res_t theme_reset() {
     if (res != LV_RES_OK)
         return res;
 
+    theme_refresh_imgs(lv_scr_act());
+
     lv_obj_invalidate(lv_scr_act());
     lv_refr_now(NULL);
 
@@ -328,6 +716,12 @@ static lv_res_t theme_reset() {
 }
 
 static void theme_reset_task(lv_task_t *task) {
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+
+    if (mon.free_size < THEME_EVICT_FREE_MIN)
+        theme_evict();
+
     mtx_lock(&g_reset_mtx);
 
     if (g_should_reset) {
@@ -342,20 +736,24 @@ lv_res_t theme_init() {
     if (R_FAILED(romfsInit()))
         return LV_RES_INV;
 
-    unzFile zf_default = unzOpen(DEFAULT_THEME_PATH);
-    unzFile zf = unzOpen(THEME_PATH);
+    theme_src_open(&g_src_default, DEFAULT_THEME_PATH);
+    theme_src_open(&g_src, THEME_PATH);
+
+    g_read_bytes = 0;
+    g_decoded_bytes = 0;
+    g_decode_ticks = 0;
 
     int i_bad;
     int ret;
     for (int i = 0; i < AssetId_max; i++) {
         i_bad = i;
-        ret = -1;
-
-        if (zf != NULL)
-            ret = asset_load(&g_assets_list[i], zf);
+        ret = UNZ_OK;
 
-        if (ret != UNZ_OK && zf_default != NULL)
-            ret = asset_load(&g_assets_list[i], zf_default);
+        // Lazy assets only have to be there, unless they're still in use from before a reset
+        if (!g_assets_list[i].lazy || g_assets_list[i].refs > 0)
+            ret = asset_materialize(&g_assets_list[i]);
+        else if (!asset_available(&g_assets_list[i]))
+            ret = UNZ_END_OF_LIST_OF_FILE;
 
         if (ret != UNZ_OK)
             break;
@@ -365,11 +763,8 @@ lv_res_t theme_init() {
         for (int i = 0; i < i_bad; i++)
             asset_clean(&g_assets_list[i]);
 
-        if (zf != NULL)
-            unzClose(zf);
-
-        if (zf_default != NULL)
-            unzClose(zf_default);
+        theme_src_close(&g_src);
+        theme_src_close(&g_src_default);
 
         romfsExit();
 
@@ -377,22 +772,29 @@ lv_res_t theme_init() {
     }
 
     theme_init_styles(&g_curr_theme);
-    theme_load_styles(&g_curr_theme, zf_default);
-    theme_load_styles(&g_curr_theme, zf);
+    theme_load_styles(&g_curr_theme, &g_src_default);
+    theme_load_styles(&g_curr_theme, &g_src);
 
-    if (zf != NULL)
-        unzClose(zf);
-
-    if (zf_default != NULL)
-        unzClose(zf_default);
+    theme_load_assets(&g_curr_theme, g_assets_list);
 
-    romfsExit();
+    u32 num_alpha[AssetAlpha_blended + 1] = {0};
+    for (int i = 0; i < AssetId_max; i++) {
+        if (g_assets_list[i].dsc != NULL && g_assets_list[i].buffer != NULL)
+            num_alpha[g_assets_list[i].alpha]++;
+    }
 
-    theme_load_assets(&g_curr_theme, g_assets_list);
+    logPrintf("theme: %u bytes read, %u bytes decoded in %lu us, %u opaque images, %u with binary alpha\n",
+        g_read_bytes, g_decoded_bytes, armTicksToNs(g_decode_ticks) / 1000, num_alpha[AssetAlpha_opaque], num_alpha[AssetAlpha_binary]);
 
     #ifdef MUSIC
 
-    if (curr_settings()->play_bgm) {
+    // The music thread can't load them itself, LVGL's heap is only used from this thread
+    if (curr_settings()->play_bgm &&
+        asset_materialize(&g_assets_list[AssetId_intro_music]) == UNZ_OK &&
+        asset_materialize(&g_assets_list[AssetId_loop_music]) == UNZ_OK) {
+        g_assets_list[AssetId_intro_music].refs = 1;
+        g_assets_list[AssetId_loop_music].refs = 1;
+
         g_curr_theme.intro_music = &g_assets_list[AssetId_intro_music];
         g_curr_theme.loop_music = &g_assets_list[AssetId_loop_music];
 
@@ -412,17 +814,28 @@ lv_res_t theme_init() {
 }
 
 void theme_exit() {
-    for (int i = 0; i < AssetId_max; i++)
-        asset_clean(&g_assets_list[i]);
-
     #ifdef MUSIC
 
-    if (curr_settings()->play_bgm) {
+    if (g_curr_theme.intro_music != NULL) {
         stop_music_loop();
         thrd_join(g_music_thread, NULL);
+
+        g_assets_list[AssetId_intro_music].refs = 0;
+        g_assets_list[AssetId_loop_music].refs = 0;
+
+        g_curr_theme.intro_music = NULL;
+        g_curr_theme.loop_music = NULL;
     }
 
     #endif
+
+    for (int i = 0; i < AssetId_max; i++)
+        asset_clean(&g_assets_list[i]);
+
+    theme_src_close(&g_src);
+    theme_src_close(&g_src_default);
+
+    romfsExit();
 }
 
 void do_theme_reset() {
@@ -431,6 +844,41 @@ void do_theme_reset() {
     mtx_unlock(&g_reset_mtx);
 }
 
+lv_res_t theme_acquire(const lv_img_dsc_t *dsc) {
+    asset_t *asset = asset_for_dsc(dsc);
+    if (asset == NULL || !asset->lazy)
+        return LV_RES_OK;
+
+    if (asset->buffer == NULL && asset_materialize(asset) != UNZ_OK) {
+        // Make room and try again
+        theme_evict();
+
+        if (asset_materialize(asset) != UNZ_OK) {
+            LV_LOG_WARN("Bad lazy asset load");
+            return LV_RES_INV;
+        }
+    }
+
+    asset->refs++;
+
+    return LV_RES_OK;
+}
+
+void theme_release(const lv_img_dsc_t *dsc) {
+    asset_t *asset = asset_for_dsc(dsc);
+    if (asset != NULL && asset->lazy && asset->refs > 0)
+        asset->refs--;
+}
+
+void theme_evict() {
+    for (int i = 0; i < AssetId_max; i++) {
+        asset_t *asset = &g_assets_list[i];
+
+        if (asset->lazy && asset->refs == 0 && asset->buffer != NULL)
+            asset_clean(asset);
+    }
+}
+
 theme_t *curr_theme() {
     return &g_curr_theme;
 }
\ No newline at end of file
@@ -36,10 +36,21 @@
 #define CURSOR_W 96
 #define CURSOR_H 96
 
+typedef enum {
+    AssetAlpha_opaque,
+    AssetAlpha_binary, // Every pixel is either opaque or fully transparent
+    AssetAlpha_blended,
+} AssetAlpha;
+
 typedef struct {
     void *buffer;
     size_t size;
     const char *file_name;
+
+    bool lazy; // Only loaded once it's acquired
+    u32 refs;
+    lv_img_dsc_t *dsc; // The descriptor that shows it, if it's an image
+    AssetAlpha alpha;
 } asset_t;
 
 typedef struct {
@@ -92,4 +103,16 @@ void theme_exit();
 
 void do_theme_reset();
 
+/*
+ * Images that are rarely needed are loaded the first time they're acquired. Once
+ * they're released they can be evicted, so they have to be acquired before
+ * they're shown and released once nothing shows them anymore. For all other
+ * images these do nothing.
+ */
+lv_res_t theme_acquire(const lv_img_dsc_t *dsc);
+void theme_release(const lv_img_dsc_t *dsc);
+
+// Frees the lazily loaded images that aren't in use
+void theme_evict();
+
 theme_t *curr_theme();
\ No newline at end of file
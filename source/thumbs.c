@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <threads.h>
+#include <sys/stat.h>
+#include <lvgl/lvgl.h>
+#include <switch.h>
+
+#include "thumbs.h"
+#include "log.h"
+#include "util.h"
+
+#define THUMB_MAGIC 0x32434248 // "HBC2"
+
+// Written before the pixels of each slot, so a slot that was reused is never mistaken for another app's
+typedef struct {
+    u32 magic;
+    u32 key;
+    u64 hash; // Of the icon's file data, so apps with the same icon can share it
+} thumb_header_t;
+
+#define THUMB_SLOT_SIZE (sizeof(thumb_header_t) + THUMB_DATA_SIZE)
+
+static FILE *g_fp = NULL;
+
+static u8 *g_used = NULL; // One byte per slot
+static u32 g_num_slots = 0;
+static u32 g_slots_cap = 0;
+
+// Icons get loaded from more than just the UI thread
+static mtx_t g_thumbs_mtx;
+static bool g_mtx_init = false;
+
+static lv_res_t grow_used(u32 min_slots) {
+    if (min_slots <= g_slots_cap)
+        return LV_RES_OK;
+
+    u32 new_cap = (g_slots_cap == 0) ? 64 : g_slots_cap;
+    while (new_cap < min_slots)
+        new_cap *= 2;
+
+    u8 *new_used = realloc(g_used, new_cap);
+    if (new_used == NULL)
+        return LV_RES_INV;
+
+    memset(new_used + g_slots_cap, 0, new_cap - g_slots_cap);
+
+    g_used = new_used;
+    g_slots_cap = new_cap;
+
+    return LV_RES_OK;
+}
+
+lv_res_t thumbs_open() {
+    if (!g_mtx_init) {
+        mtx_init(&g_thumbs_mtx, mtx_plain);
+        g_mtx_init = true;
+    }
+
+    if (g_fp != NULL)
+        return LV_RES_OK;
+
+    g_fp = fopen(THUMBS_PATH, "r+b");
+    if (g_fp == NULL)
+        g_fp = fopen(THUMBS_PATH, "w+b");
+
+    if (g_fp == NULL)
+        return LV_RES_INV;
+
+    struct stat s;
+    if (fstat(fileno(g_fp), &s) != 0) {
+        thumbs_exit();
+        return LV_RES_INV;
+    }
+
+    g_num_slots = s.st_size / THUMB_SLOT_SIZE;
+
+    if (grow_used(g_num_slots) != LV_RES_OK) {
+        thumbs_exit();
+        return LV_RES_INV;
+    }
+
+    logPrintf("thumbs: %u slots\n", g_num_slots);
+
+    return LV_RES_OK;
+}
+
+void thumbs_exit() {
+    if (g_fp != NULL)
+        fclose(g_fp);
+
+    free(g_used);
+
+    g_fp = NULL;
+    g_used = NULL;
+    g_num_slots = 0;
+    g_slots_cap = 0;
+}
+
+u32 thumbs_key(const char *path, u64 size, s64 mtime) {
+    u64 version[2] = {size, mtime};
+    return hash_str(path) ^ hash_strn((const char *) version, sizeof(version));
+}
+
+bool thumbs_claim(s32 slot) {
+    mtx_lock(&g_thumbs_mtx);
+
+    bool claimed = slot >= 0 && slot < g_num_slots && !g_used[slot];
+    if (claimed)
+        g_used[slot] = true;
+
+    mtx_unlock(&g_thumbs_mtx);
+
+    return claimed;
+}
+
+void thumbs_release(s32 slot) {
+    mtx_lock(&g_thumbs_mtx);
+
+    if (slot >= 0 && slot < g_num_slots)
+        g_used[slot] = false;
+
+    mtx_unlock(&g_thumbs_mtx);
+}
+
+lv_res_t thumbs_read(s32 slot, u32 key, u64 *hash, void *data) {
+    mtx_lock(&g_thumbs_mtx);
+
+    if (g_fp == NULL || slot < 0 || slot >= g_num_slots) {
+        mtx_unlock(&g_thumbs_mtx);
+        return LV_RES_INV;
+    }
+
+    thumb_header_t header;
+
+    bool ok = fseek(g_fp, (long) slot * THUMB_SLOT_SIZE, SEEK_SET) == 0 &&
+              fread(&header, sizeof(header), 1, g_fp) == 1 &&
+              header.magic == THUMB_MAGIC && header.key == key &&
+              (data == NULL || fread(data, THUMB_DATA_SIZE, 1, g_fp) == 1);
+
+    mtx_unlock(&g_thumbs_mtx);
+
+    if (ok)
+        *hash = header.hash;
+
+    return ok ? LV_RES_OK : LV_RES_INV;
+}
+
+s32 thumbs_write(u32 key, u64 hash, const void *data) {
+    mtx_lock(&g_thumbs_mtx);
+
+    if (g_fp == NULL) {
+        mtx_unlock(&g_thumbs_mtx);
+        return -1;
+    }
+
+    // Fill holes first to keep the file packed
+    s32 slot;
+    for (slot = 0; slot < g_num_slots && g_used[slot]; slot++);
+
+    if (slot == g_num_slots && grow_used(g_num_slots + 1) != LV_RES_OK) {
+        mtx_unlock(&g_thumbs_mtx);
+        return -1;
+    }
+
+    thumb_header_t header = {
+        .magic = THUMB_MAGIC,
+        .key = key,
+        .hash = hash,
+    };
+
+    bool ok = fseek(g_fp, (long) slot * THUMB_SLOT_SIZE, SEEK_SET) == 0 &&
+              fwrite(&header, sizeof(header), 1, g_fp) == 1 &&
+              fwrite(data, THUMB_DATA_SIZE, 1, g_fp) == 1 &&
+              fflush(g_fp) == 0;
+
+    if (!ok) {
+        mtx_unlock(&g_thumbs_mtx);
+        return -1;
+    }
+
+    if (slot == g_num_slots)
+        g_num_slots++;
+
+    g_used[slot] = true;
+
+    mtx_unlock(&g_thumbs_mtx);
+
+    return slot;
+}
+
+void thumbs_trim() {
+    mtx_lock(&g_thumbs_mtx);
+
+    u32 num_slots = g_num_slots;
+    while (num_slots > 0 && !g_used[num_slots - 1])
+        num_slots--;
+
+    if (g_fp != NULL && num_slots < g_num_slots && fflush(g_fp) == 0 && ftruncate(fileno(g_fp), (off_t) num_slots * THUMB_SLOT_SIZE) == 0) {
+        logPrintf("thumbs: trimmed %u slots\n", g_num_slots - num_slots);
+        g_num_slots = num_slots;
+    }
+
+    mtx_unlock(&g_thumbs_mtx);
+}
\ No newline at end of file
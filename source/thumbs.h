@@ -0,0 +1,36 @@
+#pragma once
+
+#include <lvgl/lvgl.h>
+#include <switch.h>
+
+#include "apps.h"
+#include "settings.h"
+
+#define THUMBS_PATH SETTINGS_DIR "/thumbs.bin"
+
+#define THUMB_DATA_SIZE (APP_ICON_SMALL_W * APP_ICON_SMALL_H * sizeof(lv_color_t))
+
+// Has to be called before any of the other functions
+lv_res_t thumbs_open();
+void thumbs_exit();
+
+// Identifies the version of an app a thumbnail was made from
+u32 thumbs_key(const char *path, u64 size, s64 mtime);
+
+/*
+ * Slots are claimed for the thumbnails that are still referenced, and
+ * released once nothing references them anymore so they can be reused.
+ */
+bool thumbs_claim(s32 slot);
+void thumbs_release(s32 slot);
+
+/*
+ * Fails if the slot holds a thumbnail for anything but the key. The hash of the
+ * icon it was made from is given too, the data is only read if it isn't NULL.
+ */
+lv_res_t thumbs_read(s32 slot, u32 key, u64 *hash, void *data);
+// Returns the slot the thumbnail was put in, or -1
+s32 thumbs_write(u32 key, u64 hash, const void *data);
+
+// Cuts released slots off the end of the file
+void thumbs_trim();
\ No newline at end of file
@@ -1,24 +1,79 @@
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <dirent.h>
 #include <errno.h>
 #include <limits.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdatomic.h>
 #include <lvgl/lvgl.h>
 #include <switch.h>
 
 #include "util.h"
 #include "log.h"
 
+static atomic_uint g_stat_count = 0;
+
+int stat_counted(char *path, struct stat *s) {
+    atomic_fetch_add(&g_stat_count, 1);
+    return stat(path, s);
+}
+
+u32 stat_count() {
+    return atomic_load(&g_stat_count);
+}
+
+void stat_count_reset() {
+    atomic_store(&g_stat_count, 0);
+}
+
 bool is_dir(char *path) {
     struct stat s;
-    return (stat(path, &s) == 0) && (s.st_mode & S_IFDIR);
+    return (stat_counted(path, &s) == 0) && (s.st_mode & S_IFDIR);
 }
 
 bool is_file(char *path) {
     struct stat s;
-    return (stat(path, &s) == 0) && (s.st_mode & S_IFREG);
+    return (stat_counted(path, &s) == 0) && (s.st_mode & S_IFREG);
+}
+
+lv_res_t walk_dir(char *path, walk_dir_cb_t cb, void *data) {
+    DIR *dp = opendir(path);
+    if (dp == NULL)
+        return LV_RES_INV;
+
+    struct dirent *ep;
+    while ((ep = readdir(dp))) {
+        if (strcmp(ep->d_name, ".") == 0 || strcmp(ep->d_name, "..") == 0)
+            continue;
+
+        bool entry_is_dir;
+
+        switch (ep->d_type) {
+            case DT_DIR:
+                entry_is_dir = true;
+                break;
+
+            case DT_REG:
+                entry_is_dir = false;
+                break;
+
+            default: {
+                char entry_path[PATH_MAX + 1];
+                snprintf(entry_path, sizeof(entry_path), "%s/%s", path, ep->d_name);
+
+                entry_is_dir = is_dir(entry_path);
+            } break;
+        }
+
+        if (!cb(ep->d_name, entry_is_dir, data))
+            break;
+    }
+
+    closedir(dp);
+
+    return LV_RES_OK;
 }
 
 char *get_ext(char *str) {
@@ -33,6 +88,102 @@ char *get_name(char *path) {
     return p + 1;
 }
 
+u32 hash_str(const char *str) {
+    return hash_strn(str, strlen(str));
+}
+
+u32 hash_strn(const char *str, size_t len) {
+    // FNV-1a
+    u32 hash = 0x811c9dc5;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (u8) str[i];
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+u64 hash_bytes(const void *data, size_t len) {
+    // 64-bit FNV-1a
+    u64 hash = 0xcbf29ce484222325;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= ((const u8 *) data)[i];
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+// Lengths of 15 go on in the following bytes, until one that isn't 255
+static bool lz4_read_len(const u8 **src, const u8 *src_end, size_t *len) {
+    if (*len != 15)
+        return true;
+
+    u8 byte;
+    do {
+        if (*src >= src_end)
+            return false;
+
+        byte = *(*src)++;
+        *len += byte;
+    } while (byte == 255);
+
+    return true;
+}
+
+int lz4_decompress(const u8 *src, size_t src_size, u8 *dst, size_t dst_size) {
+    const u8 *src_end = src + src_size;
+    u8 *dst_start = dst;
+    u8 *dst_end = dst + dst_size;
+
+    while (src < src_end) {
+        u8 token = *src++;
+
+        size_t lit_len = token >> 4;
+        if (!lz4_read_len(&src, src_end, &lit_len))
+            return -1;
+
+        if (lit_len > (size_t) (src_end - src) || lit_len > (size_t) (dst_end - dst))
+            return -1;
+
+        memcpy(dst, src, lit_len);
+        src += lit_len;
+        dst += lit_len;
+
+        // The last sequence only has literals
+        if (src >= src_end)
+            break;
+
+        if (src_end - src < 2)
+            return -1;
+
+        size_t offset = src[0] | (src[1] << 8);
+        src += 2;
+
+        if (offset == 0 || offset > (size_t) (dst - dst_start))
+            return -1;
+
+        size_t match_len = token & 0xF;
+        if (!lz4_read_len(&src, src_end, &match_len))
+            return -1;
+
+        match_len += 4;
+        if (match_len > (size_t) (dst_end - dst))
+            return -1;
+
+        // Matches can overlap what they write, so they're copied byte by byte
+        const u8 *match = dst - offset;
+        for (size_t i = 0; i < match_len; i++)
+            dst[i] = match[i];
+
+        dst += match_len;
+    }
+
+    return dst - dst_start;
+}
+
 int mkdirs(char *path, mode_t mode) {
     char tmp_dir[PATH_MAX + 1];
     tmp_dir[0] = '\0';
@@ -1,14 +1,38 @@
 #pragma once
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <lvgl/lvgl.h>
+#include <switch.h>
+
+// Counts every call so scans can report how many they made
+int stat_counted(char *path, struct stat *s);
+u32 stat_count();
+void stat_count_reset();
 
 bool is_dir(char *path);
 bool is_file(char *path);
 
+// Return false to stop walking
+typedef bool (*walk_dir_cb_t)(char *name, bool is_dir, void *data);
+
+/*
+ * Calls the callback for each entry of a directory, other than "." and "..".
+ * The entry type from readdir is used, entries are only stat'd if it's unknown.
+ */
+lv_res_t walk_dir(char *path, walk_dir_cb_t cb, void *data);
+
 char *get_ext(char *str);
 char *get_name(char *path);
 
+u32 hash_str(const char *str);
+u32 hash_strn(const char *str, size_t len);
+// Wider, for telling contents apart
+u64 hash_bytes(const void *data, size_t len);
+
+// Decompresses an LZ4 block, returns how many bytes were written or -1 if it's malformed
+int lz4_decompress(const u8 *src, size_t src_size, u8 *dst, size_t dst_size);
+
 int mkdirs(char *path, mode_t mode);
 
 lv_res_t copy(char *dest, char *from);
\ No newline at end of file
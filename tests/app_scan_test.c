@@ -0,0 +1,221 @@
+/*
+ * Scans a generated SD card with the real catalog and scan threads, with
+ * every NRO read delayed by a random amount so the jobs finish in a
+ * different order each round. The catalog has to come out in exactly
+ * the order of a serial sort of the same apps every time.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <threads.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <lvgl/lvgl.h>
+#include <switch.h>
+
+#include "apps.h"
+#include "app_order.h"
+#include "settings.h"
+
+#define NUM_APPS 300
+#define NUM_ROUNDS 8
+#define MAX_READ_DELAY_US 500
+
+static const char *g_names[] = {
+    "Checkpoint", "checkpoint", "CHECKPOINT", "EdiZon", "Goldleaf", "hbmenu", "Homebrew App Store",
+    "JKSV", "Lockpick_RCM", "NX-Shell", "nxdumptool", "RetroArch", "Tinfoil", "",
+};
+
+#define NUM_NAMES (sizeof(g_names) / sizeof(g_names[0]))
+
+static settings_t g_settings = {
+    .app_scan_limit = 256,
+};
+
+settings_t *curr_settings() {
+    return &g_settings;
+}
+
+// The apps on the generated SD card, sorted serially once they're all made
+static char g_paths[NUM_APPS][PATH_MAX];
+static app_order_key_t g_serial[NUM_APPS];
+
+static atomic_uint g_delay_seed;
+
+FILE *__real_fopen(const char *path, const char *mode);
+
+// Linked in with --wrap=fopen, the scan threads open every NRO through this
+FILE *__wrap_fopen(const char *path, const char *mode) {
+    size_t len = strlen(path);
+
+    if (len > 4 && strcmp(path + len - 4, ".nro") == 0) {
+        unsigned seed = atomic_fetch_add(&g_delay_seed, 0x9E3779B9);
+        struct timespec delay = {.tv_nsec = rand_r(&seed) % MAX_READ_DELAY_US * 1000};
+        thrd_sleep(&delay, NULL);
+    }
+
+    return __real_fopen(path, mode);
+}
+
+static void write_nro(const char *path, const char *name, int version) {
+    struct {
+        NroStart start;
+        NroHeader header;
+    } nro = {
+        .header.size = sizeof(nro),
+    };
+
+    NroAssetHeader asset_header = {
+        .magic = NROASSETHEADER_MAGIC,
+        .nacp.offset = sizeof(asset_header),
+        .nacp.size = sizeof(NacpStruct),
+    };
+
+    static NacpStruct nacp;
+    memset(&nacp, 0, sizeof(nacp));
+    strcpy(nacp.lang[0].name, name);
+    strcpy(nacp.lang[0].author, "Author");
+    snprintf(nacp.display_version, sizeof(nacp.display_version), "1.%d", version);
+
+    FILE *fp = __real_fopen(path, "wb");
+    fwrite(&nro, sizeof(nro), 1, fp);
+    fwrite(&asset_header, sizeof(asset_header), 1, fp);
+    fwrite(&nacp, sizeof(nacp), 1, fp);
+    fclose(fp);
+}
+
+// Apps in their own folders and loose in the apps folder, lots of them with the same names
+static void make_sd() {
+    mkdir("sdmc:", 0755);
+    mkdir(APP_DIR, 0755);
+    mkdir("sdmc:/config", 0755);
+    mkdir(SETTINGS_DIR, 0755);
+
+    for (int i = 0; i < NUM_APPS; i++) {
+        char *path = g_paths[i];
+
+        if (i % 4 == 0) {
+            snprintf(path, PATH_MAX, APP_DIR "/loose%03d.nro", i);
+        } else {
+            snprintf(path, PATH_MAX, APP_DIR "/app%03d", i);
+            mkdir(path, 0755);
+            snprintf(path, PATH_MAX, APP_DIR "/app%03d/app%03d.nro", i, i);
+        }
+
+        g_serial[i] = (app_order_key_t) {
+            .name = g_names[rand() % NUM_NAMES],
+            .path = path,
+            .starred = rand() % 8 == 0,
+        };
+
+        write_nro(path, g_serial[i].name, i);
+
+        // Stars are imported from .star files while there's no favorites file
+        if (g_serial[i].starred) {
+            app_entry_t entry = {.path = path};
+            char star_path[PATH_MAX + 1];
+            app_entry_get_star_path(&entry, star_path);
+            fclose(__real_fopen(star_path, "wb"));
+        }
+    }
+}
+
+// Each round scans from nothing, without the index, favorites and thumbnails of the last one
+static void clear_settings() {
+    DIR *dir = opendir(SETTINGS_DIR);
+    if (dir == NULL)
+        return;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), SETTINGS_DIR "/%s", ent->d_name);
+
+        if (ent->d_name[0] != '.')
+            unlink(path);
+    }
+
+    closedir(dir);
+}
+
+static int key_cmp(const void *a, const void *b) {
+    return app_order_cmp(a, b);
+}
+
+static int scan_round(int round) {
+    atomic_init(&g_delay_seed, round * 7919 + 1);
+
+    lv_mem_init();
+
+    static app_catalog_t catalog;
+    if (app_catalog_init(&catalog) != LV_RES_OK) {
+        printf("FAIL: round %d couldn't start the scan\n", round);
+        return 1;
+    }
+
+    app_catalog_wait(&catalog);
+
+    if (catalog.len != NUM_APPS) {
+        printf("FAIL: round %d found %u apps instead of %d\n", round, catalog.len, NUM_APPS);
+        return 1;
+    }
+
+    for (int i = 0; i < NUM_APPS; i++) {
+        app_entry_t *entry = app_catalog_get(&catalog, i);
+
+        if (strcmp(entry->path, g_serial[i].path) != 0 || strcmp(entry->name, g_serial[i].name) != 0 || entry->starred != g_serial[i].starred) {
+            printf("FAIL: round %d differs at %d: %s instead of %s\n", round, i, entry->path, g_serial[i].path);
+            return 1;
+        }
+    }
+
+    app_catalog_clear(&catalog);
+
+    return 0;
+}
+
+int main() {
+    char dir[] = "/tmp/app_scan_test.XXXXXX";
+    if (mkdtemp(dir) == NULL || chdir(dir) != 0) {
+        printf("FAIL: couldn't make the SD card folder\n");
+        return 1;
+    }
+
+    srand(0x48424321);
+    make_sd();
+
+    // Sorted from the order the apps were made in, not the order any scan found them in
+    qsort(g_serial, NUM_APPS, sizeof(app_order_key_t), key_cmp);
+
+    int failures = 0;
+
+    // The scan keeps state in the index, favorites and thumbnail modules, so each round gets a fresh process
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        clear_settings();
+
+        pid_t pid = fork();
+        if (pid == 0)
+            exit(scan_round(round));
+
+        int status;
+        if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            failures++;
+    }
+
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    system(cmd);
+
+    if (failures != 0)
+        return 1;
+
+    printf("app_scan_test: %d scans of %d apps finishing in random order match the serial order\n", NUM_ROUNDS, NUM_APPS);
+
+    return 0;
+}
\ No newline at end of file
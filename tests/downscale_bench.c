@@ -0,0 +1,171 @@
+/*
+ * Times the area averaging downscaler against the bilinear shrink it replaced,
+ * and checks that its SSE2 and NEON kernels give exactly what the scalar ones
+ * do. On x86 the NEON kernels run on the plain C intrinsics in neon/, so they
+ * aren't timed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "downscale.h"
+
+// Built from downscale.c with DOWNSCALE_SCALAR
+bool downscale_img_scalar(const uint8_t *src, uint8_t *dst, uint32_t src_w, uint32_t src_h, uint32_t dst_w, uint32_t dst_h);
+// Built from downscale.c with the NEON kernels on emulated intrinsics, it's only checked, not timed
+bool downscale_img_neon(const uint8_t *src, uint8_t *dst, uint32_t src_w, uint32_t src_h, uint32_t dst_w, uint32_t dst_h);
+
+static int pos_from_coord(int x, int y, int w) {
+    return (y * w + x) * 4;
+}
+
+// The old downscale_img from decoder.c, as it was
+static void downscale_img_bilinear(uint8_t *src, uint8_t *dst, uint32_t src_w, uint32_t src_h, uint32_t dst_w, uint32_t dst_h) {
+    if (src_w == dst_w && src_h == dst_h) {
+        memcpy(dst, src, src_w * src_h * 4);
+        return;
+    }
+
+    float x_scale = (float) src_w / (float) dst_w;
+    float y_scale = (float) src_h / (float) dst_h;
+
+    uint8_t b[4];
+    uint8_t g[4];
+    uint8_t r[4];
+    uint8_t a[4];
+    float f[4];
+    int w[4];
+
+    for (int x = 0; x < dst_w; x++) {
+        for (int y = 0; y < dst_h; y++) {
+            float src_x = x * x_scale;
+            float src_y = y * y_scale;
+            int pixel_x = src_x;
+            int pixel_y = src_y;
+
+            int pos = pos_from_coord(pixel_x, pixel_y, src_w);
+            b[0] = src[pos];
+            g[0] = src[pos + 1];
+            r[0] = src[pos + 2];
+            a[0] = src[pos + 3];
+
+            pos = pos_from_coord(pixel_x + 1, pixel_y, src_w);
+            b[1] = src[pos];
+            g[1] = src[pos + 1];
+            r[1] = src[pos + 2];
+            a[1] = src[pos + 3];
+
+            pos = pos_from_coord(pixel_x, pixel_y + 1, src_w);
+            b[2] = src[pos];
+            g[2] = src[pos + 1];
+            r[2] = src[pos + 2];
+            a[2] = src[pos + 3];
+
+            pos = pos_from_coord(pixel_x + 1, pixel_y + 1, src_w);
+            b[3] = src[pos];
+            g[3] = src[pos + 1];
+            r[3] = src[pos + 2];
+            a[3] = src[pos + 3];
+
+            f[0] = src_x - pixel_x;
+            f[1] = src_y - pixel_y;
+            f[2] = 1.0f - f[0];
+            f[3] = 1.0f - f[1];
+
+            w[0] = f[2] * f[3] * 256.0;
+            w[1] = f[0] * f[3] * 256.0;
+            w[2] = f[2] * f[1] * 256.0;
+            w[3] = f[0] * f[1] * 256.0;
+
+            pos = pos_from_coord(x, y, dst_w);
+            dst[pos] = (b[0] * w[0] + b[1] * w[1] + b[2] * w[2] + b[3] * w[3]) >> 8;
+            dst[pos + 1] = (g[0] * w[0] + g[1] * w[1] + g[2] * w[2] + g[3] * w[3]) >> 8;
+            dst[pos + 2] = (r[0] * w[0] + r[1] * w[1] + r[2] * w[2] + r[3] * w[3]) >> 8;
+            dst[pos + 3] = (a[0] * w[0] + a[1] * w[1] + a[2] * w[2] + a[3] * w[3]) >> 8;
+        }
+    }
+}
+
+typedef struct {
+    uint32_t src_w, src_h;
+    uint32_t dst_w, dst_h;
+    int iters;
+} bench_case_t;
+
+static const bench_case_t g_cases[] = {
+    {256, 256, 72, 72, 2000}, // A list icon
+    {128, 128, 72, 72, 4000}, // A list icon after the DCT scaled it down
+    {1280, 720, 256, 144, 200},
+    {97, 61, 23, 17, 4000}, // Rows that don't fill whole vectors
+};
+
+static double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main() {
+    srand(72);
+
+    printf("%-20s %12s %12s %12s\n", "case", "bilinear us", "scalar us", "simd us");
+
+    int failures = 0;
+
+    for (size_t c = 0; c < sizeof(g_cases) / sizeof(g_cases[0]); c++) {
+        const bench_case_t *bc = &g_cases[c];
+
+        // The old function reads one pixel past the edges, so it gets some slack
+        size_t src_size = (bc->src_w + 1) * (bc->src_h + 1) * 4;
+        size_t dst_size = bc->dst_w * bc->dst_h * 4;
+
+        uint8_t *src = malloc(src_size);
+        uint8_t *dst_bilinear = malloc(dst_size);
+        uint8_t *dst_scalar = malloc(dst_size);
+        uint8_t *dst_simd = malloc(dst_size);
+        uint8_t *dst_neon = malloc(dst_size);
+
+        for (size_t i = 0; i < src_size; i++)
+            src[i] = (i % 4 == 3) ? 0xFF : rand();
+
+        double t0 = now_us();
+        for (int i = 0; i < bc->iters; i++)
+            downscale_img_bilinear(src, dst_bilinear, bc->src_w, bc->src_h, bc->dst_w, bc->dst_h);
+
+        double t1 = now_us();
+        for (int i = 0; i < bc->iters; i++)
+            downscale_img_scalar(src, dst_scalar, bc->src_w, bc->src_h, bc->dst_w, bc->dst_h);
+
+        double t2 = now_us();
+        for (int i = 0; i < bc->iters; i++)
+            downscale_img(src, dst_simd, bc->src_w, bc->src_h, bc->dst_w, bc->dst_h);
+
+        double t3 = now_us();
+
+        char name[32];
+        snprintf(name, sizeof(name), "%ux%u->%ux%u", bc->src_w, bc->src_h, bc->dst_w, bc->dst_h);
+        printf("%-20s %12.2f %12.2f %12.2f\n", name, (t1 - t0) / bc->iters, (t2 - t1) / bc->iters, (t3 - t2) / bc->iters);
+
+        if (memcmp(dst_scalar, dst_simd, dst_size) != 0) {
+            printf("FAIL: the SIMD and scalar kernels differ for %s\n", name);
+            failures++;
+        }
+
+        downscale_img_neon(src, dst_neon, bc->src_w, bc->src_h, bc->dst_w, bc->dst_h);
+        if (memcmp(dst_scalar, dst_neon, dst_size) != 0) {
+            printf("FAIL: the NEON and scalar kernels differ for %s\n", name);
+            failures++;
+        }
+
+        free(src);
+        free(dst_bilinear);
+        free(dst_scalar);
+        free(dst_simd);
+        free(dst_neon);
+    }
+
+    return failures != 0;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+/*
+ * What the app scan links against but never calls in the host tests:
+ * themes, icon decoding, launching and deleting apps. Anything that
+ * does get called aborts the test.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+
+// The headers aren't included, so the stubs below don't have to match their declarations
+
+// The app's log would only clutter the test output
+void logPrintf(const char *fmt, ...) {
+}
+
+uint32_t svcSetThreadCoreMask(uint32_t handle, int32_t preferred_core, uint32_t affinity_mask) {
+    return 0;
+}
+
+#define HOST_STUB(name) void name() { abort(); }
+
+HOST_STUB(config_init)
+HOST_STUB(config_destroy)
+HOST_STUB(config_read_string)
+HOST_STUB(config_lookup)
+HOST_STUB(config_setting_lookup_string)
+HOST_STUB(unzOpen)
+HOST_STUB(unzClose)
+HOST_STUB(unzLocateFile)
+HOST_STUB(unzOpenCurrentFile)
+HOST_STUB(unzOpenCurrentFile2)
+HOST_STUB(unzCloseCurrentFile)
+HOST_STUB(unzReadCurrentFile)
+HOST_STUB(unzGetCurrentFileInfo)
+HOST_STUB(unzGetCurrentFileZStreamPos64)
+HOST_STUB(decoderDecode)
+HOST_STUB(decoderInvalidate)
+HOST_STUB(lv_img_cache_invalidate_src)
+HOST_STUB(do_theme_reset)
+HOST_STUB(stop_main_loop)
+HOST_STUB(envSetNextLoad)
+HOST_STUB(fsdevDeleteDirectoryRecursively)
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+/*
+ * Plain C versions of the NEON intrinsics downscale.c uses, following the
+ * Arm intrinsics reference, so its NEON kernels can be built and checked
+ * on a host without an AArch64 toolchain. Only the results mean anything,
+ * not the times.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t uint8x8_t __attribute__((vector_size(8)));
+typedef uint16_t uint16x4_t __attribute__((vector_size(8)));
+typedef uint16_t uint16x8_t __attribute__((vector_size(16)));
+typedef uint32_t uint32x4_t __attribute__((vector_size(16)));
+
+static inline uint8x8_t vld1_u8(const uint8_t *ptr) {
+    uint8x8_t res;
+    memcpy(&res, ptr, sizeof(res));
+    return res;
+}
+
+static inline uint16x4_t vld1_u16(const uint16_t *ptr) {
+    uint16x4_t res;
+    memcpy(&res, ptr, sizeof(res));
+    return res;
+}
+
+static inline uint32x4_t vld1q_u32(const uint32_t *ptr) {
+    uint32x4_t res;
+    memcpy(&res, ptr, sizeof(res));
+    return res;
+}
+
+static inline void vst1_u16(uint16_t *ptr, uint16x4_t val) {
+    memcpy(ptr, &val, sizeof(val));
+}
+
+static inline void vst1q_u32(uint32_t *ptr, uint32x4_t val) {
+    memcpy(ptr, &val, sizeof(val));
+}
+
+static inline uint32x4_t vdupq_n_u32(uint32_t val) {
+    return (uint32x4_t) {val, val, val, val};
+}
+
+static inline uint16x8_t vmovl_u8(uint8x8_t a) {
+    return __builtin_convertvector(a, uint16x8_t);
+}
+
+static inline uint16x4_t vget_low_u16(uint16x8_t a) {
+    return (uint16x4_t) {a[0], a[1], a[2], a[3]};
+}
+
+static inline uint16x4_t vget_high_u16(uint16x8_t a) {
+    return (uint16x4_t) {a[4], a[5], a[6], a[7]};
+}
+
+// Widening multiply-accumulate, the products are 32 bits
+static inline uint32x4_t vmlal_n_u16(uint32x4_t a, uint16x4_t b, uint16_t c) {
+    return a + __builtin_convertvector(b, uint32x4_t) * c;
+}
+
+// Shifts right and keeps the low 16 bits of each lane
+static inline uint16x4_t vshrn_n_u32(uint32x4_t a, int n) {
+    return __builtin_convertvector(a >> n, uint16x4_t);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+// The parts of libconfig the host tests build against, themes and settings aren't read by them
+
+typedef struct {
+    int unused;
+} config_t;
+
+typedef struct config_setting_t config_setting_t;
+
+#define CONFIG_TRUE 1
+#define CONFIG_FALSE 0
+
+void config_init(config_t *config);
+void config_destroy(config_t *config);
+int config_read_string(config_t *config, const char *str);
+config_setting_t *config_lookup(const config_t *config, const char *path);
+int config_setting_lookup_string(const config_setting_t *setting, const char *name, const char **value);
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+// The parts of minizip the host tests build against, themes aren't read by them
+
+typedef void *unzFile;
+typedef unsigned long long ZPOS64_T;
+
+typedef struct {
+    unsigned long version;
+    unsigned long version_needed;
+    unsigned long flag;
+    unsigned long compression_method;
+    unsigned long dosDate;
+    unsigned long crc;
+    unsigned long compressed_size;
+    unsigned long uncompressed_size;
+    unsigned long size_filename;
+    unsigned long size_file_extra;
+    unsigned long size_file_comment;
+    unsigned long disk_num_start;
+    unsigned long internal_fa;
+    unsigned long external_fa;
+} unz_file_info;
+
+#define UNZ_OK 0
+
+unzFile unzOpen(const char *path);
+int unzClose(unzFile file);
+int unzLocateFile(unzFile file, const char *name, int case_sensitivity);
+int unzOpenCurrentFile(unzFile file);
+int unzOpenCurrentFile2(unzFile file, int *method, int *level, int raw);
+int unzCloseCurrentFile(unzFile file);
+int unzReadCurrentFile(unzFile file, void *buf, unsigned len);
+int unzGetCurrentFileInfo(unzFile file, unz_file_info *info, char *name, unsigned long name_size, void *extra, unsigned long extra_size, char *comment, unsigned long comment_size);
+ZPOS64_T unzGetCurrentFileZStreamPos64(unzFile file);
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+/*
+ * The parts of libnx the host tests build against. Only the types and
+ * layouts the app scan reads have to match the real ones.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef u32 Result;
+typedef u32 Handle;
+
+#define R_FAILED(res) ((res) != 0)
+#define R_SUCCEEDED(res) ((res) == 0)
+#define BIT(n) (1U << (n))
+
+#define CUR_THREAD_HANDLE 0xFFFF8000
+
+typedef struct {
+    u32 unused;
+    u32 mod0_offset;
+    u8 padding[8];
+} NroStart;
+
+typedef struct {
+    u32 file_offset;
+    u32 size;
+} NroSegment;
+
+typedef struct {
+    u32 magic;
+    u32 unk1;
+    u32 size;
+    u32 unk2;
+    NroSegment segments[3];
+    u32 bss_size;
+    u32 unk3;
+    u8 build_id[0x20];
+    u8 padding[0x20];
+} NroHeader;
+
+#define NROASSETHEADER_MAGIC 0x54455341
+
+typedef struct {
+    u64 offset;
+    u64 size;
+} NroAssetSection;
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    NroAssetSection icon;
+    NroAssetSection nacp;
+    NroAssetSection romfs;
+} NroAssetHeader;
+
+typedef struct {
+    char name[0x200];
+    char author[0x100];
+} NacpLanguageEntry;
+
+typedef struct {
+    NacpLanguageEntry lang[16];
+    u8 unk1[0x60];
+    char display_version[0x10];
+    u8 unk2[0xF90];
+} NacpStruct;
+
+Result envSetNextLoad(const char *path, const char *argv);
+Result fsdevDeleteDirectoryRecursively(const char *path);
+Result svcSetThreadCoreMask(Handle handle, s32 preferred_core, u32 affinity_mask);
\ No newline at end of file
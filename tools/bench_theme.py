@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+
+import io
+import sys
+import time
+import zipfile
+import tempfile
+import contextlib
+from PIL import Image
+from pathlib import Path
+
+try:
+    import lz4.block
+except ImportError:
+    lz4 = None
+
+import gen_theme
+
+DEFAULT_RUNS = 20
+
+# A model of theme.c's loading in Python, not the C loader itself. minizip and
+# turbojpeg aren't host libraries here, so theme.c can't be built off the
+# console. Zip assets are inflated with zlib like minizip does, pack assets are
+# read at their offset and decoded by their encoding tag like theme_pack_read
+# does. The files stay in the page cache between runs, so the times are
+# decoding only, reading from the SD card isn't modelled. How long each asset
+# takes on the console still has to be measured there.
+
+# Decodes an asset of a pack the way theme.c does, to BGRA
+def decode_pack_asset(data, encoding, raw_size):
+    if encoding == gen_theme.ENCODING_LZ4:
+        return lz4.block.decompress(data, uncompressed_size=raw_size)
+
+    if encoding == gen_theme.ENCODING_JPEG:
+        with Image.open(io.BytesIO(data)) as im:
+            return im.tobytes("raw", "BGRX")
+
+    return data
+
+def load_zip(theme_path, times):
+    with zipfile.ZipFile(theme_path) as zf:
+        for info in zf.infolist():
+            start = time.perf_counter()
+            data = zf.read(info)
+            times[info.filename] = min(times.get(info.filename, float("inf")), time.perf_counter() - start)
+
+            assert len(data) == info.file_size
+
+def read_pack_index(f):
+    magic, version, count, _ = gen_theme.PACK_HEADER.unpack(f.read(gen_theme.PACK_HEADER.size))
+    assert magic == gen_theme.PACK_MAGIC and version == gen_theme.PACK_VERSION
+
+    index = f.read(gen_theme.PACK_ENTRY.size * count)
+
+    return [(name.rstrip(b"\0").decode(), offset, size, encoding, raw_size) for name, offset, size, encoding, raw_size in gen_theme.PACK_ENTRY.iter_unpack(index)]
+
+def load_pack(theme_path, times):
+    with open(theme_path, "rb") as f:
+        for name, offset, size, encoding, raw_size in read_pack_index(f):
+            start = time.perf_counter()
+            f.seek(offset)
+            data = decode_pack_asset(f.read(size), encoding, raw_size)
+            times[name] = min(times.get(name, float("inf")), time.perf_counter() - start)
+
+            assert len(data) == raw_size
+
+def bench(load, theme_path, runs):
+    times = {}
+    total = float("inf")
+
+    for _ in range(runs):
+        start = time.perf_counter()
+        load(theme_path, times)
+        total = min(total, time.perf_counter() - start)
+
+    return times, total
+
+def main(argv):
+    usage = "Usage: bench_theme.py <resources folder> [runs]"
+
+    if len(argv) < 1 or not Path(argv[0]).is_dir():
+        print(usage)
+        return 1
+
+    res_dir = Path(argv[0])
+    runs = int(argv[1]) if len(argv) > 1 else DEFAULT_RUNS
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        zip_path = Path(tmp_dir) / "theme.zip"
+        raw_path = Path(tmp_dir) / "theme_raw.pack"
+
+        # Encoded like the bundled theme, with opaque images as JPEGs
+        pack_path = Path(tmp_dir) / "theme.pack"
+
+        assets = gen_theme.load_assets(res_dir)
+
+        gen_theme.write_zip(zip_path, assets)
+
+        # gen_theme prints what it stored for each asset, that's left out here
+        with contextlib.redirect_stdout(io.StringIO()):
+            gen_theme.write_pack(raw_path, assets, gen_theme.encode_raw)
+
+            # Without the lz4 module the pack would be encoded with gen_theme's own compressor, but it couldn't be decoded
+            if lz4 is not None:
+                gen_theme.write_pack(pack_path, assets, lambda asset: gen_theme.encode_asset(asset, jpeg=True))
+
+        with zipfile.ZipFile(zip_path) as zf:
+            zip_sizes = {info.filename: info.compress_size for info in zf.infolist()}
+
+        with open(raw_path, "rb") as f:
+            raw_sizes = {name: size for name, _, size, _, _ in read_pack_index(f)}
+
+        pack_entries = {}
+        if lz4 is not None:
+            with open(pack_path, "rb") as f:
+                pack_entries = {name: (size, encoding) for name, _, size, encoding, _ in read_pack_index(f)}
+
+        zip_times, zip_total = bench(load_zip, zip_path, runs)
+        raw_times, raw_total = bench(load_pack, raw_path, runs)
+
+        pack_times, pack_total = {}, None
+        if lz4 is not None:
+            pack_times, pack_total = bench(load_pack, pack_path, runs)
+
+        print(f"Best of {runs} runs, bytes are what's read from the file")
+        print(f"{'asset':<28} {'zip bytes':>10} {'inflate ms':>10}  {'raw bytes':>10} {'read ms':>8}  {'pack':<4} {'bytes':>10} {'decode ms':>10}")
+
+        for name in sorted(zip_sizes):
+            line = f"{name:<28} {zip_sizes[name]:>10} {zip_times[name] * 1000:>10.3f}  {raw_sizes[name]:>10} {raw_times[name] * 1000:>8.3f}"
+
+            if name in pack_entries:
+                size, encoding = pack_entries[name]
+                line += f"  {gen_theme.ENCODING_NAMES[encoding]:<4} {size:>10} {pack_times[name] * 1000:>10.3f}"
+
+            print(line)
+
+        line = f"{'total':<28} {zip_path.stat().st_size:>10} {zip_total * 1000:>10.3f}  {raw_path.stat().st_size:>10} {raw_total * 1000:>8.3f}"
+        if pack_total is not None:
+            line += f"  {'':<4} {pack_path.stat().st_size:>10} {pack_total * 1000:>10.3f}"
+
+        print(line)
+
+        if lz4 is None:
+            print("The lz4 module isn't installed, so the LZ4 and JPEG pack is left out")
+
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
\ No newline at end of file
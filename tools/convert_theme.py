@@ -42,6 +42,11 @@ def main(argv):
         print(usage)
         return -1
 
+    # Themes on the SD card are listed by reading info.cfg and icon.jpg out of their zip, so they can't be packs
+    if Path(argv[1]).suffix == ".pack":
+        print("Converted themes have to be zips, packs are only for the theme built into romfs")
+        return -1
+
     in_dir = Path(argv[0])
     if not in_dir.is_dir():
         print("Invalid input directory")
@@ -2,21 +2,196 @@
 
 import sys
 import os
+import io
+import zlib
+import struct
 import zipfile
 from PIL import Image
 from pathlib import Path
 
-def add_asset_to_theme(zf, path, new_path):
+try:
+    import lz4.block
+except ImportError:
+    lz4 = None
+
+# Theme packs are read by theme.c, keep these in sync with it
+PACK_MAGIC = b"HBTP"
+PACK_VERSION = 2
+PACK_NAME_LEN = 48
+PACK_ALIGN = 16
+
+PACK_HEADER = struct.Struct("<4sIII")
+PACK_ENTRY = struct.Struct(f"<{PACK_NAME_LEN}sIIH2xI")
+
+ENCODING_RAW = 0
+ENCODING_LZ4 = 1
+ENCODING_JPEG = 2
+
+ENCODING_NAMES = ["raw", "lz4", "jpeg"]
+
+JPEG_QUALITY = 95
+
+LZ4_MIN_MATCH = 4
+LZ4_LAST_LITERALS = 5
+LZ4_MATCH_SAFE_DIST = 12 # Matches can't start closer to the end than this
+LZ4_MAX_OFFSET = 0xFFFF
+
+class Asset:
+    def __init__(self, name, data, image=None):
+        self.name = name
+        self.data = data
+        self.image = image # Kept so the pack can encode it as a JPEG
+
+def convert_asset(path):
     im = Image.open(path).convert("RGBA")
 
     # Convert to BGRA
     r, g, b, a = im.split()
-    im = Image.merge("RGBA", (b, g, r, a))
+    bgra = Image.merge("RGBA", (b, g, r, a))
+
+    return Asset(f"{path.stem}.bin", bgra.tobytes(), im)
+
+def lz4_write_len(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+
+    out.append(length)
+
+def lz4_write_seq(out, literals, offset=None, match_len=0):
+    lit_len = len(literals)
+
+    token = min(lit_len, 15) << 4
+    if offset is not None:
+        token |= min(match_len - LZ4_MIN_MATCH, 15)
+
+    out.append(token)
+    if lit_len >= 15:
+        lz4_write_len(out, lit_len - 15)
+
+    out += literals
+
+    if offset is not None:
+        out += struct.pack("<H", offset)
+
+        if match_len - LZ4_MIN_MATCH >= 15:
+            lz4_write_len(out, match_len - LZ4_MIN_MATCH - 15)
+
+# A greedy LZ4 block compressor, for when the lz4 module isn't installed
+def lz4_compress(data):
+    if lz4 is not None:
+        return lz4.block.compress(data, store_size=False)
+
+    out = bytearray()
+    table = {}
+
+    match_limit = len(data) - LZ4_MATCH_SAFE_DIST
+    anchor = 0
+    pos = 0
+
+    while pos < match_limit:
+        seq = data[pos:pos + LZ4_MIN_MATCH]
+        candidate = table.get(seq)
+        table[seq] = pos
+
+        if candidate is None or pos - candidate > LZ4_MAX_OFFSET:
+            pos += 1
+            continue
+
+        match_end = pos + LZ4_MIN_MATCH
+        while match_end < len(data) - LZ4_LAST_LITERALS and data[match_end] == data[candidate + match_end - pos]:
+            match_end += 1
+
+        lz4_write_seq(out, data[anchor:pos], pos - candidate, match_end - pos)
 
-    zf.writestr(new_path, im.tobytes())
+        pos = match_end
+        anchor = pos
+
+    lz4_write_seq(out, data[anchor:])
+
+    return bytes(out)
+
+# JPEGs are lossy, so opaque images are only stored as them when that's asked for
+def encode_asset(asset, jpeg=False):
+    if asset.image is None:
+        return ENCODING_RAW, asset.data
+
+    # Images with alpha need it kept exactly, so they can't be JPEGs
+    if jpeg and asset.image.getchannel("A").getextrema()[0] == 0xFF:
+        out = io.BytesIO()
+        asset.image.convert("RGB").save(out, "JPEG", quality=JPEG_QUALITY, subsampling=0)
+
+        return ENCODING_JPEG, out.getvalue()
+
+    encoded = lz4_compress(asset.data)
+    if len(encoded) >= len(asset.data):
+        return ENCODING_RAW, asset.data
+
+    return ENCODING_LZ4, encoded
+
+# What packs held before assets were encoded, read straight into their buffers
+def encode_raw(asset):
+    return ENCODING_RAW, asset.data
+
+def align(offset):
+    return (offset + PACK_ALIGN - 1) // PACK_ALIGN * PACK_ALIGN
+
+# Zips are what themes are shared as, so their assets are left as raw BGRA
+def write_zip(theme_path, assets):
+    with zipfile.ZipFile(theme_path, "w", zipfile.ZIP_DEFLATED) as zf:
+        for asset in assets:
+            zf.writestr(asset.name, asset.data)
+
+def write_pack(theme_path, assets, encode=encode_asset):
+    offset = align(PACK_HEADER.size + PACK_ENTRY.size * len(assets))
+
+    index = []
+    encoded = []
+    for asset in assets:
+        encoded_name = asset.name.encode()
+        if len(encoded_name) >= PACK_NAME_LEN:
+            raise ValueError(f"Name too long for a theme pack: {asset.name}")
+
+        encoding, data = encode(asset)
+
+        # How much the same asset reads from the SD card in a zip
+        deflated = len(zlib.compress(asset.data))
+        print(f"{asset.name:<{PACK_NAME_LEN}} {ENCODING_NAMES[encoding]:<4} {len(data):>8} bytes, {deflated:>8} deflated, {len(asset.data):>8} raw")
+
+        index.append(PACK_ENTRY.pack(encoded_name, offset, len(data), encoding, len(asset.data)))
+        encoded.append(data)
+        offset = align(offset + len(data))
+
+    with open(theme_path, "wb") as f:
+        f.write(PACK_HEADER.pack(PACK_MAGIC, PACK_VERSION, len(assets), 0))
+
+        for entry in index:
+            f.write(entry)
+
+        for data in encoded:
+            f.write(bytes(align(f.tell()) - f.tell()))
+            f.write(data)
+
+def load_assets(res_dir, ignore_exts=()):
+    assets = []
+    for p in sorted(res_dir.iterdir()):
+        if p.suffix in ignore_exts:
+            continue
+        elif p.suffix == ".png":
+            assets.append(convert_asset(p))
+        else:
+            with p.open("rb") as f:
+                assets.append(Asset(p.name, f.read()))
+
+    return assets
 
 def main(argv):
-    usage = "Usage: gen_theme.py <resources folder> <output theme.zip> [ignore extension...]"
+    usage = ("Usage: gen_theme.py [--jpeg] <resources folder> <output theme.zip or theme.pack> [ignore extension...]\n"
+        f"  --jpeg  In a pack, store fully opaque images as quality {JPEG_QUALITY} JPEGs. They're smaller and\n"
+        "          faster to load than LZ4, but lossy. Without it they're LZ4 like the rest.")
+
+    jpeg = "--jpeg" in argv
+    argv = [arg for arg in argv if arg != "--jpeg"]
 
     if len(argv) < 2:
         print(usage)
@@ -31,17 +206,12 @@ def main(argv):
     if not theme_path.parent.exists():
         os.makedirs(theme_path.parent)
 
-    ignore_exts = argv[2:]
+    assets = load_assets(res_dir, argv[2:])
 
-    with zipfile.ZipFile(theme_path, "w", zipfile.ZIP_DEFLATED) as zf:
-        for p in res_dir.iterdir():
-            if p.suffix in ignore_exts:
-                continue
-            elif p.suffix == ".png":
-                add_asset_to_theme(zf, p, f"{p.stem}.bin")
-            else:
-                with p.open("rb") as f:
-                    zf.writestr(p.name, f.read())
+    if theme_path.suffix == ".pack":
+        write_pack(theme_path, assets, lambda asset: encode_asset(asset, jpeg))
+    else:
+        write_zip(theme_path, assets)
 
     return 0
 